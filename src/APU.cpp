@@ -1,9 +1,734 @@
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include "Cartridge.h"
+#include "PPU.h"
+#include "InputManager.h"
 #include "APU.h"
+#include "MemoryManager.h"
 
-APU::APU() {
+// NTSC timings. The CPU runs at the master clock / 12.
+static const double CPUClockRate = 21477272.0 / 12;
 
+static const unsigned char lengthTable[32] = {
+        10, 254, 20, 2, 40, 4, 80, 6, 160, 8, 60, 10, 14, 12, 26, 14,
+        12, 16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+};
+
+static const unsigned char dutyTable[4][8] = {
+        {0, 1, 0, 0, 0, 0, 0, 0},
+        {0, 1, 1, 0, 0, 0, 0, 0},
+        {0, 1, 1, 1, 1, 0, 0, 0},
+        {1, 0, 0, 1, 1, 1, 1, 1}
+};
+
+static const unsigned char triangleTable[32] = {
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+static const unsigned short noisePeriods[16] = {
+        4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
+};
+
+static const unsigned short DMCPeriods[16] = {
+        428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54
+};
+
+// CPU cycles into the frame counter's sequence of each step, for the 4 and 5 step modes. The sequence restarts one
+// cycle after the last step.
+static const int frameSteps[2][4] = {
+        {7457, 14913, 22371, 29829},
+        {7457, 14913, 22371, 37281}
+};
+
+// How loud each channel is per step of its output. The real mixer isn't linear, but this is close, and mixing linearly
+// means each channel's changes can be added to the output on their own.
+static const int channelVolumes[5] = {135, 135, 153, 89, 60};
+
+static unsigned short clockNoise(unsigned short shiftRegister, bool shortMode) {
+    int feedback = (shiftRegister ^ (shiftRegister >> (shortMode ? 6 : 1))) & 1;
+    return (unsigned short) ((shiftRegister >> 1) | (feedback << 14));
+}
+
+// The noise channel's shift register is linear, so clocking it n times is the same as multiplying it by a matrix.
+// Keeping the matrices for each power of 2 clocks lets a silent noise channel skip ahead in a few steps instead of one
+// clock every few CPU cycles.
+struct NoiseJumps {
+    unsigned short columns[2][16][15]; // [short mode][log2 clocks][bit] - where each bit of the register ends up
+
+    NoiseJumps() {
+        for (int mode = 0; mode < 2; mode++) {
+            for (int bit = 0; bit < 15; bit++) {
+                columns[mode][0][bit] = clockNoise((unsigned short) (1 << bit), mode != 0);
+            }
+
+            for (int power = 1; power < 16; power++) {
+                for (int bit = 0; bit < 15; bit++) {
+                    columns[mode][power][bit] = apply(mode, power - 1, apply(mode, power - 1, (unsigned short) (1 << bit)));
+                }
+            }
+        }
+    }
+
+    unsigned short apply(int mode, int power, unsigned short shiftRegister) const {
+        unsigned short result = 0;
+
+        for (int bit = 0; bit < 15; bit++) {
+            if (shiftRegister & (1 << bit))
+                result ^= columns[mode][power][bit];
+        }
+
+        return result;
+    }
+
+    unsigned short skip(unsigned short shiftRegister, unsigned long long clocks, bool shortMode) const {
+        while (clocks > 0) {
+            unsigned long long chunk = std::min(clocks, 0xFFFFULL);
+            clocks -= chunk;
+
+            for (int power = 0; power < 16; power++) {
+                if (chunk & (1ULL << power))
+                    shiftRegister = apply(shortMode, power, shiftRegister);
+            }
+        }
+
+        return shiftRegister;
+    }
+};
+
+static void clockEnvelope(bool &start, unsigned char &divider, unsigned char &decay, unsigned char period, bool loop) {
+    if (start) {
+        start = false;
+        decay = 15;
+        divider = period;
+    } else if (divider == 0) {
+        divider = period;
+
+        if (decay > 0) {
+            decay--;
+        } else if (loop) {
+            decay = 15;
+        }
+    } else {
+        divider--;
+    }
 }
 
-APU::~APU() {
-  
+APU::APU() : synth(CPUClockRate, SampleRate) {
+    memory = nullptr;
+    profiler = nullptr;
+    silent = false;
+    lastSyncCycle = 0;
+
+    // Zero the padding in the channel structs too, so that savestates of the same state are always the same bytes
+    std::memset(pulses, 0, sizeof(pulses));
+    std::memset(&triangle, 0, sizeof(triangle));
+    std::memset(&noise, 0, sizeof(noise));
+    std::memset(&DMC, 0, sizeof(DMC));
+
+    for (int &level : sentOutput) {
+        level = 0;
+    }
+
+    reset();
+}
+
+void APU::reset() {
+    // Silence everything, as writing 0 to $4015 and $4017 would
+    for (PulseChannel &pulse : pulses) {
+        pulse.duty = pulse.sequencerStep = 0;
+        pulse.lengthHalt = pulse.constantVolume = false;
+        pulse.volume = pulse.lengthCounter = 0;
+        pulse.period = 0;
+        pulse.timer = 0;
+        pulse.envelopeStart = false;
+        pulse.envelopeDivider = pulse.envelopeDecay = 0;
+        pulse.sweepEnabled = pulse.sweepNegate = pulse.sweepReload = false;
+        pulse.sweepPeriod = pulse.sweepShift = pulse.sweepDivider = 0;
+    }
+
+    triangle.control = triangle.linearReloadFlag = false;
+    triangle.linearReload = triangle.linearCounter = triangle.lengthCounter = 0;
+    triangle.period = 0;
+    triangle.timer = 0;
+    triangle.sequencerStep = 0;
+
+    noise.lengthHalt = noise.constantVolume = noise.shortMode = false;
+    noise.volume = noise.lengthCounter = 0;
+    noise.period = noisePeriods[0];
+    noise.timer = 0;
+    noise.shiftRegister = 1;
+    noise.envelopeStart = false;
+    noise.envelopeDivider = noise.envelopeDecay = 0;
+
+    DMC.IRQEnabled = DMC.loop = false;
+    DMC.period = DMCPeriods[0];
+    DMC.timer = 0;
+    DMC.sampleAddress = DMC.currentAddress = 0xC000;
+    DMC.sampleLength = DMC.bytesRemaining = 0;
+    DMC.sampleBuffer = 0;
+    DMC.sampleBufferFull = false;
+    DMC.shiftRegister = 0;
+    DMC.bitsRemaining = 8;
+    DMC.silence = true;
+
+    channelsEnabled = 0;
+    frameMode = false;
+    frameIRQInhibit = false;
+    frameIRQ = false;
+    DMCIRQ = false;
+    frameCycle = 0;
+    frameStep = 0;
+    updateIRQLine();
+
+    output(0, 0, lastSyncCycle);
+    output(1, 0, lastSyncCycle);
+    output(2, 0, lastSyncCycle);
+    output(3, 0, lastSyncCycle);
+    output(4, 0, lastSyncCycle);
+}
+
+void APU::catchUp(unsigned long long CPUCycle) {
+    // Run the channels from one frame counter step to the next, applying each step as it's reached
+#ifdef NESTALGIA_PROFILER
+    ProfileScope scope(profiler, ProfileAPU);
+#endif
+    while (lastSyncCycle < CPUCycle) {
+        unsigned long long stepCycle = lastSyncCycle + (frameSteps[frameMode][frameStep] - frameCycle);
+        unsigned long long end = std::min(CPUCycle, stepCycle);
+
+        runChannels(lastSyncCycle, end);
+        frameCycle += (int) (end - lastSyncCycle);
+        lastSyncCycle = end;
+
+        if (end < stepCycle)
+            break;
+
+        // Every step clocks the envelopes, every other one the length counters and sweeps as well. (The 5-step
+        // sequence's fourth step, which clocks nothing, is left out of frameSteps.)
+        bool lastStep = frameStep == 3;
+        clockQuarterFrame();
+
+        if (frameStep == 1 || lastStep) {
+            clockHalfFrame();
+        }
+
+        if (lastStep && !frameMode && !frameIRQInhibit) {
+            frameIRQ = true;
+            updateIRQLine();
+        }
+
+        updatePulseOutput(0);
+        updatePulseOutput(1);
+        updateNoiseOutput();
+
+        if (lastStep) {
+            frameStep = 0;
+            frameCycle -= frameSteps[frameMode][3] + 1;
+        } else {
+            frameStep++;
+        }
+    }
+}
+
+void APU::runChannels(unsigned long long start, unsigned long long end) {
+    runPulse(0, start, end);
+    runPulse(1, start, end);
+    runTriangle(start, end);
+    runNoise(start, end);
+    runDMC(start, end);
+}
+
+void APU::runPulse(int channel, unsigned long long start, unsigned long long end) {
+    PulseChannel &pulse = pulses[channel];
+    unsigned long long time = start + pulse.timer; // When the timer next clocks the sequencer
+    int period = (pulse.period + 1) * 2;
+
+    if (time < end) {
+        if (pulse.output == 0 && pulseMuted(channel)) {
+            // The output can't change, so skip to the end and just keep the sequencer in step
+            unsigned long long clocks = (end - 1 - time) / period + 1;
+            pulse.sequencerStep = (unsigned char) ((pulse.sequencerStep - clocks) & 7);
+            time += clocks * period;
+        } else {
+            for (; time < end; time += period) {
+                pulse.sequencerStep = (pulse.sequencerStep - 1) & 7;
+                updatePulseOutput(channel, time);
+            }
+        }
+    }
+
+    pulse.timer = (int) (time - end);
+}
+
+void APU::runTriangle(unsigned long long start, unsigned long long end) {
+    unsigned long long time = start + triangle.timer;
+    int period = triangle.period + 1;
+
+    if (time < end) {
+        // The sequencer only moves while both counters are running. Periods too short to hear are left alone too,
+        // the way most games use them to silence the channel.
+        if (triangle.lengthCounter == 0 || triangle.linearCounter == 0 || triangle.period < 2) {
+            time += ((end - 1 - time) / period + 1) * period;
+        } else {
+            for (; time < end; time += period) {
+                triangle.sequencerStep = (triangle.sequencerStep + 1) & 31;
+                output(2, triangleTable[triangle.sequencerStep], time);
+            }
+        }
+    }
+
+    triangle.timer = (int) (time - end);
+}
+
+void APU::runNoise(unsigned long long start, unsigned long long end) {
+    unsigned long long time = start + noise.timer;
+
+    if (time < end && noise.output == 0 && (noise.lengthCounter == 0 || noiseVolume() == 0)) {
+        // Silent, so only the shift register needs to keep going
+        static const NoiseJumps jumps;
+        unsigned long long clocks = (end - 1 - time) / noise.period + 1;
+        noise.shiftRegister = jumps.skip(noise.shiftRegister, clocks, noise.shortMode);
+        time += clocks * noise.period;
+    }
+
+    for (; time < end; time += noise.period) {
+        noise.shiftRegister = clockNoise(noise.shiftRegister, noise.shortMode);
+        updateNoiseOutput(time);
+    }
+
+    noise.timer = (int) (time - end);
+}
+
+void APU::runDMC(unsigned long long start, unsigned long long end) {
+    unsigned long long time = start + DMC.timer;
+
+    for (; time < end; time += DMC.period) {
+        clockDMCOutput(time);
+    }
+
+    DMC.timer = (int) (time - end);
+}
+
+void APU::clockQuarterFrame() {
+    // Envelopes and the triangle's linear counter
+    for (PulseChannel &pulse : pulses) {
+        clockEnvelope(pulse.envelopeStart, pulse.envelopeDivider, pulse.envelopeDecay, pulse.volume, pulse.lengthHalt);
+    }
+
+    clockEnvelope(noise.envelopeStart, noise.envelopeDivider, noise.envelopeDecay, noise.volume, noise.lengthHalt);
+
+    if (triangle.linearReloadFlag) {
+        triangle.linearCounter = triangle.linearReload;
+    } else if (triangle.linearCounter > 0) {
+        triangle.linearCounter--;
+    }
+
+    if (!triangle.control) {
+        triangle.linearReloadFlag = false;
+    }
+}
+
+void APU::clockHalfFrame() {
+    // Length counters and sweeps
+    for (int channel = 0; channel < 2; channel++) {
+        PulseChannel &pulse = pulses[channel];
+
+        if (!pulse.lengthHalt && pulse.lengthCounter > 0) {
+            pulse.lengthCounter--;
+        }
+
+        if (pulse.sweepDivider == 0 && pulse.sweepEnabled && pulse.sweepShift > 0 && !sweepMuted(channel)) {
+            pulse.period = (unsigned short) sweepTarget(channel);
+        }
+
+        if (pulse.sweepDivider == 0 || pulse.sweepReload) {
+            pulse.sweepDivider = pulse.sweepPeriod;
+            pulse.sweepReload = false;
+        } else {
+            pulse.sweepDivider--;
+        }
+    }
+
+    if (!triangle.control && triangle.lengthCounter > 0) {
+        triangle.lengthCounter--;
+    }
+
+    if (!noise.lengthHalt && noise.lengthCounter > 0) {
+        noise.lengthCounter--;
+    }
+}
+
+void APU::clockDMCOutput(unsigned long long time) {
+    if (!DMC.silence) {
+        if (DMC.shiftRegister & 1) {
+            if (DMC.output <= 125)
+                output(4, DMC.output + 2, time);
+        } else {
+            if (DMC.output >= 2)
+                output(4, DMC.output - 2, time);
+        }
+    }
+
+    DMC.shiftRegister >>= 1;
+
+    if (--DMC.bitsRemaining == 0) {
+        // Start the next byte of the sample, if it has been read yet
+        DMC.bitsRemaining = 8;
+        DMC.silence = !DMC.sampleBufferFull;
+
+        if (DMC.sampleBufferFull) {
+            DMC.shiftRegister = DMC.sampleBuffer;
+            DMC.sampleBufferFull = false;
+            fetchDMCSample();
+        }
+    }
+}
+
+void APU::fetchDMCSample() {
+    // The real DMC stalls the CPU for a few cycles while it reads, that isn't emulated
+    if (DMC.sampleBufferFull || DMC.bytesRemaining == 0)
+        return;
+
+    DMC.sampleBuffer = memory->readMemory(DMC.currentAddress);
+    DMC.sampleBufferFull = true;
+    DMC.currentAddress = DMC.currentAddress == 0xFFFF ? 0x8000 : DMC.currentAddress + 1;
+
+    if (--DMC.bytesRemaining == 0) {
+        if (DMC.loop) {
+            DMC.currentAddress = DMC.sampleAddress;
+            DMC.bytesRemaining = DMC.sampleLength;
+        } else if (DMC.IRQEnabled) {
+            DMCIRQ = true;
+            updateIRQLine();
+        }
+    }
+}
+
+int APU::sweepTarget(int channel) {
+    const PulseChannel &pulse = pulses[channel];
+    int change = pulse.period >> pulse.sweepShift;
+
+    if (pulse.sweepNegate) {
+        // Pulse 1 adds the ones' complement, pulse 2 the two's complement
+        return pulse.period - change - (channel == 0 ? 1 : 0);
+    }
+
+    return pulse.period + change;
+}
+
+bool APU::sweepMuted(int channel) {
+    // The sweep unit silences the channel when the period is, or would go, out of range - even when it's disabled
+    return pulses[channel].period < 8 || sweepTarget(channel) > 0x7FF;
+}
+
+bool APU::pulseMuted(int channel) {
+    const PulseChannel &pulse = pulses[channel];
+    int volume = pulse.constantVolume ? pulse.volume : pulse.envelopeDecay;
+    return pulse.lengthCounter == 0 || volume == 0 || sweepMuted(channel);
+}
+
+void APU::updatePulseOutput(int channel) {
+    updatePulseOutput(channel, lastSyncCycle);
+}
+
+void APU::updatePulseOutput(int channel, unsigned long long time) {
+    const PulseChannel &pulse = pulses[channel];
+    int level = 0;
+
+    if (!pulseMuted(channel) && dutyTable[pulse.duty][pulse.sequencerStep]) {
+        level = pulse.constantVolume ? pulse.volume : pulse.envelopeDecay;
+    }
+
+    output(channel, level, time);
+}
+
+int APU::noiseVolume() {
+    return noise.constantVolume ? noise.volume : noise.envelopeDecay;
+}
+
+void APU::updateNoiseOutput() {
+    updateNoiseOutput(lastSyncCycle);
+}
+
+void APU::updateNoiseOutput(unsigned long long time) {
+    int level = 0;
+
+    if (noise.lengthCounter > 0 && !(noise.shiftRegister & 1)) {
+        level = noiseVolume();
+    }
+
+    output(3, level, time);
+}
+
+void APU::output(int channel, int level, unsigned long long time) {
+    int *current;
+
+    switch (channel) {
+        case 0:
+        case 1:
+            current = &pulses[channel].output;
+            break;
+        case 2:
+            current = &triangle.output;
+            break;
+        case 3:
+            current = &noise.output;
+            break;
+        default:
+            current = &DMC.output;
+            break;
+    }
+
+    *current = level;
+
+    if (!silent && level != sentOutput[channel]) {
+        synth.addDelta(time, (level - sentOutput[channel]) * channelVolumes[channel]);
+        sentOutput[channel] = level;
+    }
+}
+
+void APU::updateIRQLine() {
+    IRQLine = frameIRQ || DMCIRQ;
+}
+
+void APU::writeRegister(unsigned short location, unsigned char value, unsigned long long CPUCycle) {
+    catchUp(CPUCycle);
+
+    switch (location) {
+        case 0x4000:
+        case 0x4004: {
+            PulseChannel &pulse = pulses[(location - 0x4000) / 4];
+            pulse.duty = value >> 6;
+            pulse.lengthHalt = (value & 0x20) != 0;
+            pulse.constantVolume = (value & 0x10) != 0;
+            pulse.volume = value & 0xF;
+            break;
+        }
+        case 0x4001:
+        case 0x4005: {
+            PulseChannel &pulse = pulses[(location - 0x4000) / 4];
+            pulse.sweepEnabled = (value & 0x80) != 0;
+            pulse.sweepPeriod = (value >> 4) & 7;
+            pulse.sweepNegate = (value & 0x08) != 0;
+            pulse.sweepShift = value & 7;
+            pulse.sweepReload = true;
+            break;
+        }
+        case 0x4002:
+        case 0x4006: {
+            PulseChannel &pulse = pulses[(location - 0x4000) / 4];
+            pulse.period = (unsigned short) ((pulse.period & 0x700) | value);
+            break;
+        }
+        case 0x4003:
+        case 0x4007: {
+            int channel = (location - 0x4000) / 4;
+            PulseChannel &pulse = pulses[channel];
+            pulse.period = (unsigned short) ((pulse.period & 0xFF) | ((value & 7) << 8));
+            pulse.sequencerStep = 0;
+            pulse.envelopeStart = true;
+
+            if (channelsEnabled & (1 << channel))
+                pulse.lengthCounter = lengthTable[value >> 3];
+
+            break;
+        }
+        case 0x4008:
+            triangle.control = (value & 0x80) != 0;
+            triangle.linearReload = value & 0x7F;
+            break;
+        case 0x400A:
+            triangle.period = (unsigned short) ((triangle.period & 0x700) | value);
+            break;
+        case 0x400B:
+            triangle.period = (unsigned short) ((triangle.period & 0xFF) | ((value & 7) << 8));
+            triangle.linearReloadFlag = true;
+
+            if (channelsEnabled & 0x04)
+                triangle.lengthCounter = lengthTable[value >> 3];
+
+            break;
+        case 0x400C:
+            noise.lengthHalt = (value & 0x20) != 0;
+            noise.constantVolume = (value & 0x10) != 0;
+            noise.volume = value & 0xF;
+            break;
+        case 0x400E:
+            noise.shortMode = (value & 0x80) != 0;
+            noise.period = noisePeriods[value & 0xF];
+            break;
+        case 0x400F:
+            noise.envelopeStart = true;
+
+            if (channelsEnabled & 0x08)
+                noise.lengthCounter = lengthTable[value >> 3];
+
+            break;
+        case 0x4010:
+            DMC.IRQEnabled = (value & 0x80) != 0;
+            DMC.loop = (value & 0x40) != 0;
+            DMC.period = DMCPeriods[value & 0xF];
+
+            if (!DMC.IRQEnabled)
+                DMCIRQ = false;
+
+            break;
+        case 0x4011:
+            output(4, value & 0x7F, CPUCycle);
+            break;
+        case 0x4012:
+            DMC.sampleAddress = (unsigned short) (0xC000 + value * 64);
+            break;
+        case 0x4013:
+            DMC.sampleLength = (unsigned short) (value * 16 + 1);
+            break;
+        case 0x4015:
+            channelsEnabled = value & 0x1F;
+
+            if (!(value & 0x01))
+                pulses[0].lengthCounter = 0;
+
+            if (!(value & 0x02))
+                pulses[1].lengthCounter = 0;
+
+            if (!(value & 0x04))
+                triangle.lengthCounter = 0;
+
+            if (!(value & 0x08))
+                noise.lengthCounter = 0;
+
+            if (!(value & 0x10)) {
+                DMC.bytesRemaining = 0;
+            } else if (DMC.bytesRemaining == 0) {
+                DMC.currentAddress = DMC.sampleAddress;
+                DMC.bytesRemaining = DMC.sampleLength;
+                fetchDMCSample();
+            }
+
+            DMCIRQ = false;
+            break;
+        case 0x4017:
+            frameMode = (value & 0x80) != 0;
+            frameIRQInhibit = (value & 0x40) != 0;
+
+            if (frameIRQInhibit)
+                frameIRQ = false;
+
+            frameCycle = 0;
+            frameStep = 0;
+
+            // The 5-step sequence clocks everything as soon as it's selected
+            if (frameMode) {
+                clockQuarterFrame();
+                clockHalfFrame();
+            }
+
+            break;
+        default:
+            break;
+    }
+
+    updateIRQLine();
+    updatePulseOutput(0);
+    updatePulseOutput(1);
+    updateNoiseOutput();
+}
+
+unsigned char APU::readStatus(unsigned long long CPUCycle) {
+    catchUp(CPUCycle);
+
+    unsigned char status = 0;
+    status |= pulses[0].lengthCounter > 0 ? 0x01 : 0;
+    status |= pulses[1].lengthCounter > 0 ? 0x02 : 0;
+    status |= triangle.lengthCounter > 0 ? 0x04 : 0;
+    status |= noise.lengthCounter > 0 ? 0x08 : 0;
+    status |= DMC.bytesRemaining > 0 ? 0x10 : 0;
+    status |= frameIRQ ? 0x40 : 0;
+    status |= DMCIRQ ? 0x80 : 0;
+
+    // Reading the status acknowledges the frame IRQ
+    frameIRQ = false;
+    updateIRQLine();
+
+    return status;
+}
+
+int APU::cyclesUntilIRQ(unsigned long long CPUCycle) {
+    catchUp(CPUCycle);
+
+    int cycles = INT_MAX;
+
+    if (!frameMode && !frameIRQInhibit && !frameIRQ) {
+        cycles = frameSteps[0][3] - frameCycle;
+    }
+
+    if (DMC.IRQEnabled && !DMC.loop && !DMCIRQ && DMC.bytesRemaining > 0) {
+        // The last byte is read as the byte before it starts playing, 8 DMC clocks per byte
+        long long DMCCycles = DMC.timer + (long long) (DMC.bitsRemaining - 1) * DMC.period +
+                              (long long) (DMC.bytesRemaining - 1) * 8 * DMC.period;
+        cycles = (int) std::min((long long) cycles, DMCCycles);
+    }
+
+    return std::max(cycles, 1);
+}
+
+void APU::endFrame(unsigned long long CPUCycle) {
+#ifdef NESTALGIA_PROFILER
+    ProfileScope scope(profiler, ProfileAPU);
+#endif
+    catchUp(CPUCycle);
+
+    if (!silent) {
+        synth.endFrame(CPUCycle);
+    }
+}
+
+const std::vector<short> &APU::getSamples() {
+    return synth.getSamples();
+}
+
+void APU::setRateAdjust(double adjust) {
+    synth.setRates(CPUClockRate, SampleRate * adjust);
+}
+
+void APU::saveState(StateWriter &state) {
+    state.write(pulses);
+    state.write(triangle);
+    state.write(noise);
+    state.write(DMC);
+    state.write(channelsEnabled);
+    state.write(frameMode);
+    state.write(frameIRQInhibit);
+    state.write(frameIRQ);
+    state.write(DMCIRQ);
+    state.write(frameCycle);
+    state.write(frameStep);
+    state.write(lastSyncCycle);
+}
+
+void APU::loadState(StateReader &state) {
+    state.read(pulses);
+    state.read(triangle);
+    state.read(noise);
+    state.read(DMC);
+    state.read(channelsEnabled);
+    state.read(frameMode);
+    state.read(frameIRQInhibit);
+    state.read(frameIRQ);
+    state.read(DMCIRQ);
+    state.read(frameCycle);
+    state.read(frameStep);
+    state.read(lastSyncCycle);
+    updateIRQLine();
+
+    // The sound carries on from where it was, stepping to the loaded levels
+    synth.setTime(lastSyncCycle);
+
+    output(0, pulses[0].output, lastSyncCycle);
+    output(1, pulses[1].output, lastSyncCycle);
+    output(2, triangle.output, lastSyncCycle);
+    output(3, noise.output, lastSyncCycle);
+    output(4, DMC.output, lastSyncCycle);
 }
@@ -1,5 +1,171 @@
+#pragma once
+
+#include <vector>
+#include "SaveState.h"
+#include "BandLimitedBuffer.h"
+#include "Profiler.h"
+
+class MemoryManager;
+
+// The channels' state is kept in plain structs so that it can be written straight into a savestate
+struct PulseChannel {
+  unsigned char duty;
+  unsigned char sequencerStep;
+  bool lengthHalt; // Also loops the envelope
+  bool constantVolume;
+  unsigned char volume; // Also the envelope's period
+  unsigned char lengthCounter;
+  unsigned short period; // Timer reload value, in APU cycles
+  int timer; // CPU cycles until the timer next clocks the sequencer
+  bool envelopeStart;
+  unsigned char envelopeDivider;
+  unsigned char envelopeDecay;
+  bool sweepEnabled;
+  unsigned char sweepPeriod;
+  bool sweepNegate;
+  unsigned char sweepShift;
+  unsigned char sweepDivider;
+  bool sweepReload;
+  int output;
+};
+
+struct TriangleChannel {
+  bool control; // Halts the length counter and keeps reloading the linear counter
+  unsigned char linearReload;
+  unsigned char linearCounter;
+  bool linearReloadFlag;
+  unsigned char lengthCounter;
+  unsigned short period;
+  int timer;
+  unsigned char sequencerStep;
+  int output;
+};
+
+struct NoiseChannel {
+  bool lengthHalt;
+  bool constantVolume;
+  unsigned char volume;
+  unsigned char lengthCounter;
+  bool shortMode; // Feedback from bit 6 instead of bit 1, for a metallic 93 step sequence
+  unsigned short period; // In CPU cycles
+  int timer;
+  unsigned short shiftRegister;
+  bool envelopeStart;
+  unsigned char envelopeDivider;
+  unsigned char envelopeDecay;
+  int output;
+};
+
+struct DMCChannel {
+  bool IRQEnabled;
+  bool loop;
+  unsigned short period; // In CPU cycles
+  int timer;
+  unsigned short sampleAddress;
+  unsigned short sampleLength;
+  unsigned short currentAddress;
+  unsigned short bytesRemaining;
+  unsigned char sampleBuffer;
+  bool sampleBufferFull;
+  unsigned char shiftRegister;
+  unsigned char bitsRemaining;
+  bool silence;
+  int output; // The 7-bit output level
+};
+
+/*
+ * The 2A03's audio processing unit: two pulse channels, a triangle, a noise channel and the DMC, plus the frame counter
+ * that clocks their envelopes, sweeps and length counters.
+ *
+ * Like the PPU, the APU only runs when something needs it - a register access, an IRQ check or the end of a frame - and
+ * then catches up to the CPU in one go. Rather than stepping each channel every cycle, it runs from one timer clock to
+ * the next, and each change in a channel's output is added to a BandLimitedBuffer as a step. The buffer is turned into
+ * 48kHz samples once per frame by endFrame().
+ */
 class APU {
 public:
+  static const int SampleRate = 48000;
+
+  bool IRQLine; // Raised by the frame counter or the DMC, until the CPU acknowledges it
+  bool silent; // Keep emulating but don't make any sound, for frames that will be thrown away (run-ahead)
+  MemoryManager *memory; // For the DMC's sample fetches
+  Profiler *profiler; // Times catching up when NESTALGIA_PROFILER is defined
+
   APU();
-  ~APU();
+
+  void reset();
+
+  void catchUp(unsigned long long CPUCycle); // Run the APU up to the given CPU cycle
+
+  void writeRegister(unsigned short location, unsigned char value, unsigned long long CPUCycle);
+
+  unsigned char readStatus(unsigned long long CPUCycle); // $4015
+
+  int cyclesUntilIRQ(unsigned long long CPUCycle); // CPU cycles until the APU will next raise an IRQ, INT_MAX if it won't
+
+  void endFrame(unsigned long long CPUCycle); // Turn everything up to the given CPU cycle into samples
+
+  const std::vector<short> &getSamples(); // The mono samples made by the last endFrame()
+
+  void setRateAdjust(double adjust); // Make adjust times as many samples as normal from the next frame on
+
+  void saveState(StateWriter &state);
+
+  void loadState(StateReader &state);
+
+private:
+  PulseChannel pulses[2];
+  TriangleChannel triangle;
+  NoiseChannel noise;
+  DMCChannel DMC;
+
+  unsigned char channelsEnabled; // Bits written to $4015
+  bool frameMode; // false: 4-step sequence, true: 5-step sequence
+  bool frameIRQInhibit;
+  bool frameIRQ;
+  bool DMCIRQ;
+  int frameCycle; // CPU cycles since the frame counter's sequence started
+  int frameStep; // The next step of the sequence
+  unsigned long long lastSyncCycle; // The CPU cycle the APU was last caught up to
+
+  BandLimitedBuffer synth;
+  int sentOutput[5]; // Each channel's output level as last added to synth
+
+  void runChannels(unsigned long long start, unsigned long long end);
+
+  void runPulse(int channel, unsigned long long start, unsigned long long end);
+
+  void runTriangle(unsigned long long start, unsigned long long end);
+
+  void runNoise(unsigned long long start, unsigned long long end);
+
+  void runDMC(unsigned long long start, unsigned long long end);
+
+  void clockQuarterFrame();
+
+  void clockHalfFrame();
+
+  void clockDMCOutput(unsigned long long time);
+
+  void fetchDMCSample();
+
+  int sweepTarget(int channel); // The period the sweep unit would change the pulse channel's period to
+
+  bool sweepMuted(int channel);
+
+  bool pulseMuted(int channel);
+
+  void updatePulseOutput(int channel); // Work out the channel's output level again, at the time the APU has run to
+
+  void updatePulseOutput(int channel, unsigned long long time);
+
+  int noiseVolume();
+
+  void updateNoiseOutput();
+
+  void updateNoiseOutput(unsigned long long time);
+
+  void output(int channel, int level, unsigned long long time); // Add the channel's change to level at the given time
+
+  void updateIRQLine();
 };
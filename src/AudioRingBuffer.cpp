@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cstring>
+#include "AudioRingBuffer.h"
+
+AudioRingBuffer::AudioRingBuffer(size_t mCapacity) {
+    size_t size = 1;
+
+    while (size < mCapacity) {
+        size <<= 1;
+    }
+
+    buffer.resize(size);
+    mask = size - 1;
+    writePosition = 0;
+    readPosition = 0;
+    underruns = 0;
+    overruns = 0;
+    droppedSamples = 0;
+}
+
+void AudioRingBuffer::write(const short *samples, size_t count) {
+    // The reader only ever frees up space, so what's free now will still be free after copying
+    size_t position = writePosition.load(std::memory_order_relaxed);
+    size_t free = buffer.size() - (position - readPosition.load(std::memory_order_acquire));
+
+    if (count > free) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        droppedSamples.fetch_add(count - free, std::memory_order_relaxed);
+        count = free;
+    }
+
+    // Copy in up to two parts, either side of the end of the buffer
+    size_t start = position & mask;
+    size_t first = std::min(count, buffer.size() - start);
+    std::memcpy(&buffer[start], samples, first * sizeof(short));
+    std::memcpy(&buffer[0], samples + first, (count - first) * sizeof(short));
+
+    // Publish the samples only once they're in place
+    writePosition.store(position + count, std::memory_order_release);
+}
+
+size_t AudioRingBuffer::space() {
+    return buffer.size() - available();
+}
+
+void AudioRingBuffer::read(short *samples, size_t count) {
+    size_t position = readPosition.load(std::memory_order_relaxed);
+    size_t buffered = writePosition.load(std::memory_order_acquire) - position;
+    size_t copied = std::min(count, buffered);
+
+    size_t start = position & mask;
+    size_t first = std::min(copied, buffer.size() - start);
+    std::memcpy(samples, &buffer[start], first * sizeof(short));
+    std::memcpy(samples + first, &buffer[0], (copied - first) * sizeof(short));
+
+    if (copied < count) {
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        std::fill(samples + copied, samples + count, 0);
+    }
+
+    // Hand the space back to the writer only once the samples have been copied out
+    readPosition.store(position + copied, std::memory_order_release);
+}
+
+size_t AudioRingBuffer::available() {
+    size_t read = readPosition.load(std::memory_order_acquire);
+    size_t written = writePosition.load(std::memory_order_acquire);
+    return std::min(written - read, buffer.size());
+}
+
+size_t AudioRingBuffer::capacity() {
+    return buffer.size();
+}
+
+unsigned long long AudioRingBuffer::getUnderruns() {
+    return underruns.load(std::memory_order_relaxed);
+}
+
+unsigned long long AudioRingBuffer::getOverruns() {
+    return overruns.load(std::memory_order_relaxed);
+}
+
+unsigned long long AudioRingBuffer::getDroppedSamples() {
+    return droppedSamples.load(std::memory_order_relaxed);
+}
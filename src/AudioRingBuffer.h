@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/*
+ * Carries samples from the emulation thread to the audio thread. One thread writes and one reads, and neither ever
+ * waits for the other: each side only moves its own position, and reads the other's to see how much it may use.
+ *
+ * When the writer gets too far ahead the samples that don't fit are dropped (an overrun), and when the reader runs out
+ * it is given silence (an underrun). Both are counted, so the frontend can show how well emulation and playback are
+ * keeping pace with each other.
+ */
+class AudioRingBuffer {
+public:
+    explicit AudioRingBuffer(size_t mCapacity); // Rounded up to a power of 2
+
+    // Writer side
+    void write(const short *samples, size_t count); // Writes as many as fit, dropping the rest
+
+    size_t space(); // Samples that can be written right now
+
+    // Reader side
+    void read(short *samples, size_t count); // Fills in with silence if there aren't count samples buffered
+
+    // Either side
+    size_t available(); // Samples buffered and not yet read
+
+    size_t capacity();
+
+    unsigned long long getUnderruns(); // Reads that ran out of samples
+
+    unsigned long long getOverruns(); // Writes that didn't fit
+
+    unsigned long long getDroppedSamples(); // Samples lost to overruns
+
+private:
+    std::vector<short> buffer;
+    size_t mask;
+
+    // The total number of samples ever written and read. Only the writer changes writePosition and only the reader
+    // changes readPosition.
+    std::atomic<size_t> writePosition;
+    std::atomic<size_t> readPosition;
+
+    std::atomic<unsigned long long> underruns;
+    std::atomic<unsigned long long> overruns;
+    std::atomic<unsigned long long> droppedSamples;
+};
@@ -0,0 +1,105 @@
+#include <cmath>
+#include <algorithm>
+#include "BandLimitedBuffer.h"
+
+// Enough space for a frame at the slowest frame rate a game could run at, plus the tail of the last step
+static const int MaxSamplesPerFrame = 4096;
+
+BandLimitedBuffer::BandLimitedBuffer(double mClockRate, int mSampleRate) {
+    const double Pi = 3.14159265358979323846;
+    const double Cutoff = 0.9; // Of the output's Nyquist frequency, leaving room for the window's roll-off
+
+    // Build a windowed sinc for each phase, normalised so that it adds up to exactly 1 << DeltaBits. Anything else and
+    // the steps would drift away from the level they should settle at.
+    for (int phase = 0; phase < Phases; phase++) {
+        double impulse[KernelWidth];
+        double total = 0;
+
+        for (int tap = 0; tap < KernelWidth; tap++) {
+            double distance = tap - KernelWidth / 2 + 1 - (double) phase / Phases;
+            double sinc = distance == 0 ? 1 : std::sin(Pi * Cutoff * distance) / (Pi * Cutoff * distance);
+            double window = 0.42 + 0.5 * std::cos(Pi * distance / (KernelWidth / 2)) +
+                            0.08 * std::cos(2 * Pi * distance / (KernelWidth / 2)); // Blackman
+            impulse[tap] = std::fabs(distance) < KernelWidth / 2 ? sinc * window : 0;
+            total += impulse[tap];
+        }
+
+        int sum = 0;
+
+        for (int tap = 0; tap < KernelWidth; tap++) {
+            kernels[phase][tap] = (short) std::lround(impulse[tap] / total * (1 << DeltaBits));
+            sum += kernels[phase][tap];
+        }
+
+        // Put the rounding error on the biggest tap, where it makes the least difference
+        kernels[phase][KernelWidth / 2 - 1] += (short) ((1 << DeltaBits) - sum);
+    }
+
+    setRates(mClockRate, mSampleRate);
+    buffer.resize(MaxSamplesPerFrame + KernelWidth);
+    samples.reserve(MaxSamplesPerFrame);
+    frameStart = 0;
+    clear();
+}
+
+void BandLimitedBuffer::addDelta(unsigned long long time, int delta) {
+    if (time < frameStart)
+        return;
+
+    unsigned long long position = frameOffset + (time - frameStart) * samplesPerClock;
+    size_t sample = (size_t) (position >> 32);
+
+    if (sample >= MaxSamplesPerFrame)
+        return; // Too far past the end of the frame - drop it rather than write past the buffer
+
+    const short *kernel = kernels[(position >> (32 - PhaseBits)) & (Phases - 1)];
+    int *output = &buffer[sample];
+
+    for (int tap = 0; tap < KernelWidth; tap++) {
+        output[tap] += kernel[tap] * delta;
+    }
+}
+
+void BandLimitedBuffer::endFrame(unsigned long long time) {
+    // Samples before the one the end time falls in can't be touched by steps after it, so they are finished
+    unsigned long long position = frameOffset + (time - frameStart) * samplesPerClock;
+    size_t count = std::min((size_t) (position >> 32), (size_t) MaxSamplesPerFrame);
+
+    samples.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        integrator += buffer[i];
+        int sample = integrator >> DeltaBits;
+
+        // Leak a little of the total away each sample, so that the output settles back to 0 when the level is steady
+        integrator -= sample << (DeltaBits - BassShift);
+        samples.push_back((short) std::max(-32768, std::min(32767, sample)));
+    }
+
+    // Keep the tails of the steps that spill into the next frame
+    std::copy(buffer.begin() + count, buffer.end(), buffer.begin());
+    std::fill(buffer.end() - count, buffer.end(), 0);
+
+    frameOffset = position - ((unsigned long long) count << 32);
+    frameStart = time;
+}
+
+void BandLimitedBuffer::setTime(unsigned long long time) {
+    frameStart = time;
+}
+
+void BandLimitedBuffer::setRates(double clockRate, double sampleRate) {
+    // Positions within a frame are worked out from its start, so the new ratio applies cleanly from the next frame on
+    samplesPerClock = (unsigned long long) std::llround(sampleRate / clockRate * 4294967296.0);
+}
+
+void BandLimitedBuffer::clear() {
+    std::fill(buffer.begin(), buffer.end(), 0);
+    samples.clear();
+    frameOffset = 0;
+    integrator = 0;
+}
+
+const std::vector<short> &BandLimitedBuffer::getSamples() {
+    return samples;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+/*
+ * Turns a signal described by the times and sizes of its steps into samples at a lower rate, without the aliasing that
+ * sampling the steps directly would cause.
+ *
+ * Each step is added as a band-limited impulse, spread over the output samples around it from a table of windowed
+ * sincs at several sub-sample phases. Adding the samples up (once per frame, in endFrame()) turns the impulses back
+ * into steps. The work done depends on the number of steps, not the clock rate, so a channel that holds the same level
+ * for a whole frame costs nothing.
+ *
+ * Times are in clocks of the source (CPU cycles for the APU), counted from any point as long as they only go forward.
+ */
+class BandLimitedBuffer {
+public:
+    BandLimitedBuffer(double mClockRate, int mSampleRate);
+
+    void addDelta(unsigned long long time, int delta); // The signal steps up (or down) by delta at the given time
+
+    void endFrame(unsigned long long time); // Finish the samples up to the given time, replacing the last frame's
+
+    void setTime(unsigned long long time); // Carry on from a different time, e.g. after loading a state
+
+    void setRates(double clockRate, double sampleRate); // Change the resampling ratio. Only call between frames.
+
+    void clear(); // Drop everything not yet read and go back to silence
+
+    const std::vector<short> &getSamples(); // The samples finished by the last endFrame()
+
+private:
+    static const int PhaseBits = 5;
+    static const int Phases = 1 << PhaseBits; // Sub-sample positions with a kernel of their own
+    static const int KernelWidth = 16; // Output samples each step is spread over
+    static const int DeltaBits = 15; // Fixed point precision of the kernels - each one adds up to 1 << DeltaBits
+    static const int BassShift = 9; // Strength of the high-pass filter that removes DC, about 15Hz at 48kHz
+
+    short kernels[Phases][KernelWidth];
+    std::vector<int> buffer; // Impulses not yet added up into samples, buffer[0] is the next sample to finish
+    std::vector<short> samples;
+    unsigned long long samplesPerClock; // Output samples per source clock, 32.32 fixed point
+    unsigned long long frameStart; // The source time of position 0 of the buffer
+    unsigned long long frameOffset; // The position of frameStart in the buffer, in samples as 32.32 fixed point
+    int integrator; // Running total of the impulses, high-pass filtered
+};
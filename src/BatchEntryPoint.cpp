@@ -0,0 +1,255 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include "ProjectInfo.h"
+#include "MainSystem.h"
+#include "Hash.h"
+
+// Runs a list of ROMs with no display, one emulator per worker thread, and reports how each run ended.
+//
+// The job list has one job per line: <rom file> <frame count> [input script]. Blank lines and lines starting with #
+// are skipped. An input script has one change of controller state per line: <frame> <buttons>, where buttons is the
+// packed button byte (bit 0 = A ... bit 7 = Right, decimal or 0x hex). Each state is held from the start of its frame
+// until the next change.
+
+struct BatchJob {
+    std::string ROMFileName;
+    int frameCount;
+    std::string inputFileName;
+};
+
+struct BatchResult {
+    bool success;
+    std::string error;
+    int framesRun;
+    unsigned long long frameHash;
+    unsigned long long RAMHash;
+    std::vector<unsigned char> RAM;
+    double seconds;
+};
+
+static bool readJobList(const std::string &fileName, std::vector<BatchJob> &jobs) {
+    std::ifstream jobFile(fileName);
+
+    if (!jobFile) {
+        std::cerr << "Error - job list " << fileName << " not found." << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(jobFile, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        BatchJob job;
+
+        if (!(fields >> job.ROMFileName) || job.ROMFileName[0] == '#')
+            continue;
+
+        if (!(fields >> job.frameCount) || job.frameCount < 0) {
+            std::cerr << "Error - " << fileName << " line " << lineNumber << ": expected a frame count" << std::endl;
+            return false;
+        }
+
+        fields >> job.inputFileName;
+        jobs.push_back(job);
+    }
+
+    return true;
+}
+
+static bool readInputScript(const std::string &fileName, std::map<int, unsigned char> &inputs, std::string &error) {
+    std::ifstream inputFile(fileName);
+
+    if (!inputFile) {
+        error = "input script " + fileName + " not found";
+        return false;
+    }
+
+    std::string line;
+
+    while (std::getline(inputFile, line)) {
+        std::istringstream fields(line);
+        std::string frame;
+        std::string buttons;
+
+        if (!(fields >> frame) || frame[0] == '#')
+            continue;
+
+        if (!(fields >> buttons)) {
+            error = "input script " + fileName + ": expected buttons after frame " + frame;
+            return false;
+        }
+
+        inputs[std::atoi(frame.c_str())] = (unsigned char) std::strtol(buttons.c_str(), nullptr, 0);
+    }
+
+    return true;
+}
+
+static void runJob(const BatchJob &job, BatchResult &result) {
+    // Every job gets an emulator of its own, and its messages are kept rather than mixed in with the other threads'
+    std::ostringstream log;
+    MainSystem emulator;
+    emulator.setLog(log);
+
+    result.success = false;
+    result.framesRun = 0;
+    result.frameHash = 0;
+    result.RAMHash = 0;
+    result.seconds = 0;
+
+    std::map<int, unsigned char> inputs;
+
+    if (!job.inputFileName.empty() && !readInputScript(job.inputFileName, inputs, result.error))
+        return;
+
+    if (!emulator.loadROM(job.ROMFileName)) {
+        // The first error logged says why
+        std::istringstream lines(log.str());
+        std::string line;
+
+        while (std::getline(lines, line)) {
+            if (line.compare(0, 5, "Error") == 0) {
+                result.error = line;
+                break;
+            }
+        }
+
+        if (result.error.empty())
+            result.error = "could not load ROM";
+
+        return;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto nextInput = inputs.begin();
+
+    while (result.framesRun < job.frameCount && emulator.isRunning()) {
+        for (; nextInput != inputs.end() && nextInput->first <= result.framesRun; ++nextInput) {
+            emulator.getInput().Update(nextInput->second);
+        }
+
+        emulator.execute();
+        result.framesRun++;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    result.seconds = elapsed.count();
+
+    const unsigned char *RAM = emulator.getRAM();
+    result.RAM.assign(RAM, RAM + 0x800);
+    result.RAMHash = hashBytes(RAM, 0x800);
+    result.frameHash = emulator.getPPU().getFrameHash();
+    result.success = emulator.isRunning();
+
+    if (!result.success)
+        result.error = "CPU stopped";
+}
+
+int main(int argc, char *argv[]) {
+    // Options:
+    // --threads <n>: number of worker threads (one per core by default)
+    // --output <directory>: write each job's final RAM to <directory>/<job number>.ram
+    std::string jobListFileName;
+    std::string outputDirectory;
+    int threadCount = (int) std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = std::string(argv[i]);
+
+        if (argument == "--threads" && i + 1 < argc) {
+            threadCount = std::atoi(argv[++i]);
+        } else if (argument == "--output" && i + 1 < argc) {
+            outputDirectory = argv[++i];
+        } else {
+            jobListFileName = argument;
+        }
+    }
+
+    if (jobListFileName.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <job list> [--threads n] [--output directory]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << PROJECT_NAME << " " << PROJECT_VERSION << PROJECT_OS << PROJECT_ARCH << " (Compiled: " << __DATE__
+              << " - " << __TIME__ << ") " << " starting batch..." << std::endl;
+
+    std::vector<BatchJob> jobs;
+
+    if (!readJobList(jobListFileName, jobs))
+        return EXIT_FAILURE;
+
+    if (threadCount < 1)
+        threadCount = 1;
+
+    if (threadCount > (int) jobs.size())
+        threadCount = std::max(1, (int) jobs.size());
+
+    // Workers take the next job off the list until there are none left. Results go into their own slot, so the only
+    // thing the threads share is the job counter.
+    std::vector<BatchResult> results(jobs.size());
+    std::atomic<size_t> nextJob(0);
+    std::vector<std::thread> workers;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back([&]() {
+            for (size_t job = nextJob++; job < jobs.size(); job = nextJob++) {
+                runJob(jobs[job], results[job]);
+            }
+        });
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    // Report the results in job list order, as tab separated values
+    std::cout << "job\trom\tframes\tframe_hash\tram_hash\tseconds\tstatus" << std::endl;
+    int failures = 0;
+    long long totalFrames = 0;
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const BatchResult &result = results[i];
+
+        std::cout << i << "\t" << jobs[i].ROMFileName << "\t" << result.framesRun << "\t" << std::hex << std::setfill('0')
+                  << std::setw(16) << result.frameHash << "\t" << std::setw(16) << result.RAMHash << std::dec
+                  << std::setfill(' ') << "\t" << result.seconds << "\t" << (result.success ? "ok" : result.error)
+                  << std::endl;
+
+        if (!result.success)
+            failures++;
+
+        totalFrames += result.framesRun;
+
+        if (!outputDirectory.empty() && !result.RAM.empty()) {
+            std::ofstream RAMFile(outputDirectory + "/" + std::to_string(i) + ".ram", std::ios::binary);
+            RAMFile.write((const char *) result.RAM.data(), result.RAM.size());
+        }
+    }
+
+    std::cerr << "Ran " << jobs.size() << " jobs (" << totalFrames << " frames) on " << threadCount << " threads in "
+              << elapsed.count() << "s";
+
+    if (elapsed.count() > 0) {
+        std::cerr << " (" << totalFrames / elapsed.count() << " frames per second)";
+    }
+
+    std::cerr << std::endl;
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
-#include <fstream>
+#include <ostream>
 #include "CPUInstructions.h"
+#include "SaveState.h"
+#include "Profiler.h"
 
 using namespace M6502;
 
@@ -10,13 +12,13 @@ class CPU6502 {
 public:
     explicit CPU6502(MemoryManager &mManager);
 
-    ~CPU6502();
-
     CPUState state;
     bool fireBRK;
     bool fireReset;
     bool fireNMI;
     bool interruptProcessed;
+    std::ostream *log; // Where errors are written
+    Profiler *profiler; // Counts each instruction when NESTALGIA_PROFILER is defined
 
     void SetFlag(Flag flag, bool val);
 
@@ -38,6 +40,8 @@ public:
 
     unsigned char GetY();
 
+    unsigned long long GetInstructionCount(); // Instructions executed since the last reset, used for throughput reporting
+
     // Items below here should in future be private, but for unit testing purposes they are currently public.
     unsigned char rA, rX, rY; // CPU registers
     unsigned char AND(unsigned char value);
@@ -86,36 +90,35 @@ public:
 
     int Execute();
 
+    int Run(int cycleBudget); // Executes instructions until at least cycleBudget cycles have run, returns the cycles run
+
     void Reset();
 
+    void SaveState(StateWriter &state); // Write the registers and everything else needed to carry on where the CPU left off
+
+    void LoadState(StateReader &state);
+
     void HandleInterrupt(
             int type); // Forces the CPU to jump to an interrupt vector. may be called be a CPU instruction or piece of emulated hardware
     void FireInterrupt(int type);
 
 private:
-    unsigned char b1;
     unsigned char flagRegister;
     unsigned short programCounter;
-    signed char dataOffset; // Causes the programCounter to be incremented at the end of an instruction
     unsigned short jumpOffset; // Used to tell the CPU where to jump next
-    int cyclesTaken = 0;
     unsigned char stackPointer;
     bool pageBoundaryPassed;
-    unsigned char location;
-    unsigned short location16;
-    unsigned char result;
     MemoryManager *memory;
-    std::ofstream *redirectFile;
-    unsigned char currentInstruction;
     int cpuCycles;
+    unsigned long long instructionCount;
 
     unsigned char nextByte();
 
     void JMP(unsigned short location);
 
-    void branch(bool value);
+    int branch(bool value);
 
-    void printCPUStatus(std::string instructionName);
+    unsigned short fetchAddress(AddressingMode mode);
 
     std::string getInstructionName(unsigned char opcode);
 
@@ -137,7 +140,5 @@ private:
 
     void fBRK();
 
-    std::string decToHex(int value);
-
     void checkInterrupts();
 };
@@ -0,0 +1,266 @@
+#include "CPUInstructions.h"
+
+namespace M6502 {
+
+    // Decoded form of every opcode, indexed by the opcode itself. This is the single source of truth for instruction
+    // names, addressing modes and timings - CPU6502::Execute() dispatches from it and getInstructionName() reads from it.
+    // Opcodes which have no handler use opUnknown and halt the CPU with an error.
+    const Instruction instructionTable[256] = {
+        /* 0x00 */ {"BRK    ", Implied, opBRK, 7, false},
+        /* 0x01 */ {"ORA_INX", IndirectX, opORA, 6, false},
+        /* 0x02 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x03 */ {"SLO_INX", IndirectX, opSLO, 8, false},
+        /* 0x04 */ {"NOP_ZP ", ZeroPage, opNOP, 3, false},
+        /* 0x05 */ {"ORA_ZP ", ZeroPage, opORA, 3, false},
+        /* 0x06 */ {"ASL_ZP ", ZeroPage, opASL, 5, false},
+        /* 0x07 */ {"SLO_ZP ", ZeroPage, opSLO, 5, false},
+        /* 0x08 */ {"PHP    ", Implied, opPHP, 3, false},
+        /* 0x09 */ {"ORA_IMM", Immediate, opORA, 2, false},
+        /* 0x0A */ {"ASL_ACC", Accumulator, opASL, 2, false},
+        /* 0x0B */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x0C */ {"NOP_AB ", Absolute, opNOP, 4, false},
+        /* 0x0D */ {"ORA_AB ", Absolute, opORA, 4, false},
+        /* 0x0E */ {"ASL_AB ", Absolute, opASL, 6, false},
+        /* 0x0F */ {"SLO_AB ", Absolute, opSLO, 6, false},
+        /* 0x10 */ {"BPL    ", Relative, opBPL, 2, false},
+        /* 0x11 */ {"ORA_INY", IndirectY, opORA, 5, true},
+        /* 0x12 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x13 */ {"SLO_INY", IndirectY, opSLO, 8, false},
+        /* 0x14 */ {"NOP_ZPX", ZeroPageX, opNOP, 4, false},
+        /* 0x15 */ {"ORA_ZPX", ZeroPageX, opORA, 4, false},
+        /* 0x16 */ {"ASL_ZPX", ZeroPageX, opASL, 6, false},
+        /* 0x17 */ {"SLO_ZPX", ZeroPageX, opSLO, 6, false},
+        /* 0x18 */ {"CLC    ", Implied, opCLC, 2, false},
+        /* 0x19 */ {"ORA_ABY", AbsoluteY, opORA, 4, true},
+        /* 0x1A */ {"NOP    ", Implied, opNOP, 2, false},
+        /* 0x1B */ {"SLO_ABY", AbsoluteY, opSLO, 7, false},
+        /* 0x1C */ {"NOP_ABX", AbsoluteX, opNOP, 4, true},
+        /* 0x1D */ {"ORA_ABX", AbsoluteX, opORA, 4, true},
+        /* 0x1E */ {"ASL_ABX", AbsoluteX, opASL, 7, false},
+        /* 0x1F */ {"SLO_ABX", AbsoluteX, opSLO, 7, false},
+        /* 0x20 */ {"JSR    ", Absolute, opJSR, 6, false},
+        /* 0x21 */ {"AND_INX", IndirectX, opAND, 6, false},
+        /* 0x22 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x23 */ {"RLA_INX", IndirectX, opRLA, 8, false},
+        /* 0x24 */ {"BIT_ZP ", ZeroPage, opBIT, 3, false},
+        /* 0x25 */ {"AND_ZP ", ZeroPage, opAND, 3, false},
+        /* 0x26 */ {"ROL_ZP ", ZeroPage, opROL, 5, false},
+        /* 0x27 */ {"RLA_ZP ", ZeroPage, opRLA, 5, false},
+        /* 0x28 */ {"PLP    ", Implied, opPLP, 4, false},
+        /* 0x29 */ {"AND_IMM", Immediate, opAND, 2, false},
+        /* 0x2A */ {"ROL_ACC", Accumulator, opROL, 2, false},
+        /* 0x2B */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x2C */ {"BIT_AB ", Absolute, opBIT, 4, false},
+        /* 0x2D */ {"AND_AB ", Absolute, opAND, 4, false},
+        /* 0x2E */ {"ROL_AB ", Absolute, opROL, 6, false},
+        /* 0x2F */ {"RLA_AB ", Absolute, opRLA, 6, false},
+        /* 0x30 */ {"BMI    ", Relative, opBMI, 2, false},
+        /* 0x31 */ {"AND_INY", IndirectY, opAND, 5, true},
+        /* 0x32 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x33 */ {"RLA_INY", IndirectY, opRLA, 8, false},
+        /* 0x34 */ {"NOP_ZPX", ZeroPageX, opNOP, 4, false},
+        /* 0x35 */ {"AND_ZPX", ZeroPageX, opAND, 4, false},
+        /* 0x36 */ {"ROL_ZPX", ZeroPageX, opROL, 6, false},
+        /* 0x37 */ {"RLA_ZPX", ZeroPageX, opRLA, 6, false},
+        /* 0x38 */ {"SEC    ", Implied, opSEC, 2, false},
+        /* 0x39 */ {"AND_ABY", AbsoluteY, opAND, 4, true},
+        /* 0x3A */ {"NOP    ", Implied, opNOP, 2, false},
+        /* 0x3B */ {"RLA_ABY", AbsoluteY, opRLA, 7, false},
+        /* 0x3C */ {"NOP_ABX", AbsoluteX, opNOP, 4, true},
+        /* 0x3D */ {"AND_ABX", AbsoluteX, opAND, 4, true},
+        /* 0x3E */ {"ROL_ABX", AbsoluteX, opROL, 7, false},
+        /* 0x3F */ {"RLA_ABX", AbsoluteX, opRLA, 7, false},
+        /* 0x40 */ {"RTI    ", Implied, opRTI, 6, false},
+        /* 0x41 */ {"EOR_INX", IndirectX, opEOR, 6, false},
+        /* 0x42 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x43 */ {"SRE_INX", IndirectX, opSRE, 8, false},
+        /* 0x44 */ {"NOP_ZP ", ZeroPage, opNOP, 3, false},
+        /* 0x45 */ {"EOR_ZP ", ZeroPage, opEOR, 3, false},
+        /* 0x46 */ {"LSR_ZP ", ZeroPage, opLSR, 5, false},
+        /* 0x47 */ {"SRE_ZP ", ZeroPage, opSRE, 5, false},
+        /* 0x48 */ {"PHA    ", Implied, opPHA, 3, false},
+        /* 0x49 */ {"EOR_IMM", Immediate, opEOR, 2, false},
+        /* 0x4A */ {"LSR_A  ", Accumulator, opLSR, 2, false},
+        /* 0x4B */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x4C */ {"JMP_AB ", Absolute, opJMP, 3, false},
+        /* 0x4D */ {"EOR_AB ", Absolute, opEOR, 4, false},
+        /* 0x4E */ {"LSR_AB ", Absolute, opLSR, 6, false},
+        /* 0x4F */ {"SRE_AB ", Absolute, opSRE, 6, false},
+        /* 0x50 */ {"BVC    ", Relative, opBVC, 2, false},
+        /* 0x51 */ {"EOR_INY", IndirectY, opEOR, 5, true},
+        /* 0x52 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x53 */ {"SRE_INY", IndirectY, opSRE, 8, false},
+        /* 0x54 */ {"NOP_ZPX", ZeroPageX, opNOP, 4, false},
+        /* 0x55 */ {"EOR_ZPX", ZeroPageX, opEOR, 4, false},
+        /* 0x56 */ {"LSR_ZPX", ZeroPageX, opLSR, 6, false},
+        /* 0x57 */ {"SRE_ZPX", ZeroPageX, opSRE, 6, false},
+        /* 0x58 */ {"CLI    ", Implied, opCLI, 2, false},
+        /* 0x59 */ {"EOR_ABY", AbsoluteY, opEOR, 4, true},
+        /* 0x5A */ {"NOP    ", Implied, opNOP, 2, false},
+        /* 0x5B */ {"SRE_ABY", AbsoluteY, opSRE, 7, false},
+        /* 0x5C */ {"NOP_ABX", AbsoluteX, opNOP, 4, true},
+        /* 0x5D */ {"EOR_ABX", AbsoluteX, opEOR, 4, true},
+        /* 0x5E */ {"LSR_ABX", AbsoluteX, opLSR, 7, false},
+        /* 0x5F */ {"SRE_ABX", AbsoluteX, opSRE, 7, false},
+        /* 0x60 */ {"RTS    ", Implied, opRTS, 6, false},
+        /* 0x61 */ {"ADC_INX", IndirectX, opADC, 6, false},
+        /* 0x62 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x63 */ {"RRA_INX", IndirectX, opRRA, 8, false},
+        /* 0x64 */ {"NOP_ZP ", ZeroPage, opNOP, 3, false},
+        /* 0x65 */ {"ADC_ZP ", ZeroPage, opADC, 3, false},
+        /* 0x66 */ {"ROR_ZP ", ZeroPage, opROR, 5, false},
+        /* 0x67 */ {"RRA_ZP ", ZeroPage, opRRA, 5, false},
+        /* 0x68 */ {"PLA    ", Implied, opPLA, 4, false},
+        /* 0x69 */ {"ADC_IMM", Immediate, opADC, 2, false},
+        /* 0x6A */ {"ROR_ACC", Accumulator, opROR, 2, false},
+        /* 0x6B */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x6C */ {"JMP_IN ", Indirect, opJMP, 5, false},
+        /* 0x6D */ {"ADC_AB ", Absolute, opADC, 4, false},
+        /* 0x6E */ {"ROR_AB ", Absolute, opROR, 6, false},
+        /* 0x6F */ {"RRA_AB ", Absolute, opRRA, 6, false},
+        /* 0x70 */ {"BVS    ", Relative, opBVS, 2, false},
+        /* 0x71 */ {"ADC_INY", IndirectY, opADC, 5, true},
+        /* 0x72 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x73 */ {"RRA_INY", IndirectY, opRRA, 8, false},
+        /* 0x74 */ {"NOP_ZPX", ZeroPageX, opNOP, 4, false},
+        /* 0x75 */ {"ADC_ZPX", ZeroPageX, opADC, 4, false},
+        /* 0x76 */ {"ROR_ZPX", ZeroPageX, opROR, 6, false},
+        /* 0x77 */ {"RRA_ZPX", ZeroPageX, opRRA, 6, false},
+        /* 0x78 */ {"SEI    ", Implied, opSEI, 2, false},
+        /* 0x79 */ {"ADC_ABY", AbsoluteY, opADC, 4, true},
+        /* 0x7A */ {"NOP    ", Implied, opNOP, 2, false},
+        /* 0x7B */ {"RRA_ABY", AbsoluteY, opRRA, 7, false},
+        /* 0x7C */ {"NOP_ABX", AbsoluteX, opNOP, 4, true},
+        /* 0x7D */ {"ADC_ABX", AbsoluteX, opADC, 4, true},
+        /* 0x7E */ {"ROR_ABX", AbsoluteX, opROR, 7, false},
+        /* 0x7F */ {"RRA_ABX", AbsoluteX, opRRA, 7, false},
+        /* 0x80 */ {"NOP_IMM", Immediate, opNOP, 2, false},
+        /* 0x81 */ {"STA_INX", IndirectX, opSTA, 6, false},
+        /* 0x82 */ {"NOP_IMM", Immediate, opNOP, 2, false},
+        /* 0x83 */ {"SAX_INX", IndirectX, opSAX, 6, false},
+        /* 0x84 */ {"STY_ZP ", ZeroPage, opSTY, 3, false},
+        /* 0x85 */ {"STA_ZP ", ZeroPage, opSTA, 3, false},
+        /* 0x86 */ {"STX_ZP ", ZeroPage, opSTX, 3, false},
+        /* 0x87 */ {"SAX_ZP ", ZeroPage, opSAX, 3, false},
+        /* 0x88 */ {"DEY    ", Implied, opDEY, 2, false},
+        /* 0x89 */ {"NOP_IMM", Immediate, opNOP, 2, false},
+        /* 0x8A */ {"TXA    ", Implied, opTXA, 2, false},
+        /* 0x8B */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x8C */ {"STY_AB ", Absolute, opSTY, 4, false},
+        /* 0x8D */ {"STA_AB ", Absolute, opSTA, 4, false},
+        /* 0x8E */ {"STX_AB ", Absolute, opSTX, 4, false},
+        /* 0x8F */ {"SAX_AB", Absolute, opSAX, 4, false},
+        /* 0x90 */ {"BCC    ", Relative, opBCC, 2, false},
+        /* 0x91 */ {"STA_INY", IndirectY, opSTA, 6, false},
+        /* 0x92 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x93 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x94 */ {"STY_ZPX", ZeroPageX, opSTY, 4, false},
+        /* 0x95 */ {"STA_ZPX", ZeroPageX, opSTA, 4, false},
+        /* 0x96 */ {"STX_ZPY", ZeroPageY, opSTX, 4, false},
+        /* 0x97 */ {"SAX_ZPY", ZeroPageY, opSAX, 4, false},
+        /* 0x98 */ {"TYA    ", Implied, opTYA, 2, false},
+        /* 0x99 */ {"STA_ABY", AbsoluteY, opSTA, 5, false},
+        /* 0x9A */ {"TXS    ", Implied, opTXS, 2, false},
+        /* 0x9B */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x9C */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x9D */ {"STA_ABX", AbsoluteX, opSTA, 5, false},
+        /* 0x9E */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0x9F */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0xA0 */ {"LDY_IMM", Immediate, opLDY, 2, false},
+        /* 0xA1 */ {"LDA_INX", IndirectX, opLDA, 6, false},
+        /* 0xA2 */ {"LDX_IMM", Immediate, opLDX, 2, false},
+        /* 0xA3 */ {"LAX_INX", IndirectX, opLAX, 6, false},
+        /* 0xA4 */ {"LDY_ZP ", ZeroPage, opLDY, 3, false},
+        /* 0xA5 */ {"LDA_ZP ", ZeroPage, opLDA, 3, false},
+        /* 0xA6 */ {"LDX_ZP ", ZeroPage, opLDX, 3, false},
+        /* 0xA7 */ {"LAX_ZP ", ZeroPage, opLAX, 3, false},
+        /* 0xA8 */ {"TAY    ", Implied, opTAY, 2, false},
+        /* 0xA9 */ {"LDA_IMM", Immediate, opLDA, 2, false},
+        /* 0xAA */ {"TAX    ", Implied, opTAX, 2, false},
+        /* 0xAB */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0xAC */ {"LDY_AB ", Absolute, opLDY, 4, false},
+        /* 0xAD */ {"LDA_AB ", Absolute, opLDA, 4, false},
+        /* 0xAE */ {"LDX_AB ", Absolute, opLDX, 4, false},
+        /* 0xAF */ {"LAX_AB ", Absolute, opLAX, 4, false},
+        /* 0xB0 */ {"BCS    ", Relative, opBCS, 2, false},
+        /* 0xB1 */ {"LDA_INY", IndirectY, opLDA, 5, true},
+        /* 0xB2 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0xB3 */ {"LAX_INY", IndirectY, opLAX, 5, true},
+        /* 0xB4 */ {"LDY_ZPX", ZeroPageX, opLDY, 4, false},
+        /* 0xB5 */ {"LDA_ZPX", ZeroPageX, opLDA, 4, false},
+        /* 0xB6 */ {"LDX_ZPY", ZeroPageY, opLDX, 4, false},
+        /* 0xB7 */ {"LAX_ZPY", ZeroPageY, opLAX, 4, false},
+        /* 0xB8 */ {"CLV    ", Implied, opCLV, 2, false},
+        /* 0xB9 */ {"LDA_ABY", AbsoluteY, opLDA, 4, true},
+        /* 0xBA */ {"TSX    ", Implied, opTSX, 2, false},
+        /* 0xBB */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0xBC */ {"LDY_ABX", AbsoluteX, opLDY, 4, true},
+        /* 0xBD */ {"LDA_ABX", AbsoluteX, opLDA, 4, true},
+        /* 0xBE */ {"LDX_ABY", AbsoluteY, opLDX, 4, true},
+        /* 0xBF */ {"LAX_ABY", AbsoluteY, opLAX, 4, true},
+        /* 0xC0 */ {"CPY_IMM", Immediate, opCPY, 2, false},
+        /* 0xC1 */ {"CMP_INX", IndirectX, opCMP, 6, false},
+        /* 0xC2 */ {"NOP_IMM", Immediate, opNOP, 2, false},
+        /* 0xC3 */ {"DCP_INX", IndirectX, opDCP, 8, false},
+        /* 0xC4 */ {"CPY_ZP ", ZeroPage, opCPY, 3, false},
+        /* 0xC5 */ {"CMP_ZP ", ZeroPage, opCMP, 3, false},
+        /* 0xC6 */ {"DEC_ZP ", ZeroPage, opDEC, 5, false},
+        /* 0xC7 */ {"DCP_ZP", ZeroPage, opDCP, 5, false},
+        /* 0xC8 */ {"INY    ", Implied, opINY, 2, false},
+        /* 0xC9 */ {"CMP_IMM", Immediate, opCMP, 2, false},
+        /* 0xCA */ {"DEX    ", Implied, opDEX, 2, false},
+        /* 0xCB */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0xCC */ {"CPY_AB ", Absolute, opCPY, 4, false},
+        /* 0xCD */ {"CMP_AB ", Absolute, opCMP, 4, false},
+        /* 0xCE */ {"DEC_AB ", Absolute, opDEC, 6, false},
+        /* 0xCF */ {"DCP_AB", Absolute, opDCP, 6, false},
+        /* 0xD0 */ {"BNE    ", Relative, opBNE, 2, false},
+        /* 0xD1 */ {"CMP_INY", IndirectY, opCMP, 5, true},
+        /* 0xD2 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0xD3 */ {"DCP_INY", IndirectY, opDCP, 8, false},
+        /* 0xD4 */ {"NOP_ZPX", ZeroPageX, opNOP, 4, false},
+        /* 0xD5 */ {"CMP_ZPX", ZeroPageX, opCMP, 4, false},
+        /* 0xD6 */ {"DEC_ZPX", ZeroPageX, opDEC, 6, false},
+        /* 0xD7 */ {"DCP_ZPX", ZeroPageX, opDCP, 6, false},
+        /* 0xD8 */ {"CLD    ", Implied, opCLD, 2, false},
+        /* 0xD9 */ {"CMP_ABY", AbsoluteY, opCMP, 4, true},
+        /* 0xDA */ {"NOP    ", Implied, opNOP, 2, false},
+        /* 0xDB */ {"DCP_ABY", AbsoluteY, opDCP, 7, false},
+        /* 0xDC */ {"NOP_ABX", AbsoluteX, opNOP, 4, true},
+        /* 0xDD */ {"CMP_ABX", AbsoluteX, opCMP, 4, true},
+        /* 0xDE */ {"DEC_ABX", AbsoluteX, opDEC, 7, false},
+        /* 0xDF */ {"DCP_ABX", AbsoluteX, opDCP, 7, false},
+        /* 0xE0 */ {"CPX_IMM", Immediate, opCPX, 2, false},
+        /* 0xE1 */ {"SBC_INX", IndirectX, opSBC, 6, false},
+        /* 0xE2 */ {"NOP_IMM", Immediate, opNOP, 2, false},
+        /* 0xE3 */ {"ISB_INX", IndirectX, opISB, 8, false},
+        /* 0xE4 */ {"CPX_ZP ", ZeroPage, opCPX, 3, false},
+        /* 0xE5 */ {"SBC_ZP ", ZeroPage, opSBC, 3, false},
+        /* 0xE6 */ {"INC_ZP ", ZeroPage, opINC, 5, false},
+        /* 0xE7 */ {"ISB_ZP ", ZeroPage, opISB, 5, false},
+        /* 0xE8 */ {"INX    ", Implied, opINX, 2, false},
+        /* 0xE9 */ {"SBC_IMM", Immediate, opSBC, 2, false},
+        /* 0xEA */ {"NOP    ", Implied, opNOP, 2, false},
+        /* 0xEB */ {"SBC_IMM", Immediate, opSBC, 2, false},
+        /* 0xEC */ {"CPX_AB ", Absolute, opCPX, 4, false},
+        /* 0xED */ {"SBC_AB ", Absolute, opSBC, 4, false},
+        /* 0xEE */ {"INC_AB ", Absolute, opINC, 6, false},
+        /* 0xEF */ {"ISB_AB ", Absolute, opISB, 6, false},
+        /* 0xF0 */ {"BEQ    ", Relative, opBEQ, 2, false},
+        /* 0xF1 */ {"SBC_INY", IndirectY, opSBC, 5, true},
+        /* 0xF2 */ {"UNKNOWN-OPCODE", Implied, opUnknown, 0, false},
+        /* 0xF3 */ {"ISB_INY", IndirectY, opISB, 8, false},
+        /* 0xF4 */ {"NOP_ZPX", ZeroPageX, opNOP, 4, false},
+        /* 0xF5 */ {"SBC_ZPX", ZeroPageX, opSBC, 4, false},
+        /* 0xF6 */ {"INC_ZPX", ZeroPageX, opINC, 6, false},
+        /* 0xF7 */ {"ISB_ZPX", ZeroPageX, opISB, 6, false},
+        /* 0xF8 */ {"SED    ", Implied, opSED, 2, false},
+        /* 0xF9 */ {"SBC_ABY", AbsoluteY, opSBC, 4, true},
+        /* 0xFA */ {"*NOP   ", Implied, opNOP, 2, false},
+        /* 0xFB */ {"ISB_ABY", AbsoluteY, opISB, 7, false},
+        /* 0xFC */ {"NOP_ABX", AbsoluteX, opNOP, 4, true},
+        /* 0xFD */ {"SBC_ABX", AbsoluteX, opSBC, 4, true},
+        /* 0xFE */ {"INC_ABX", AbsoluteX, opINC, 7, false},
+        /* 0xFF */ {"ISB_ABX", AbsoluteX, opISB, 7, false}
+    };
+}
@@ -323,4 +323,39 @@ namespace M6502
 
 	enum CPUState {Running,Halt,Interrupt,Stopped,Error,WaitForInterrupt};
 	enum CPUInterrupt {iNMI,iReset,iIRQ,iBRK};
+
+	enum AddressingMode: unsigned char {
+		Implied, Accumulator, Immediate, ZeroPage, ZeroPageX, ZeroPageY, Absolute, AbsoluteX, AbsoluteY, Indirect,
+		IndirectX, IndirectY, Relative
+	};
+
+	// Every operation the CPU can perform. Listed once here so that the Operation enum and the computed goto table in
+	// CPU6502::Execute() can never get out of step with each other.
+#define CPU_OPERATIONS(OPERATION) \
+		OPERATION(ADC) OPERATION(AND) OPERATION(ASL) OPERATION(BCC) OPERATION(BCS) OPERATION(BEQ) OPERATION(BIT) OPERATION(BMI) \
+		OPERATION(BNE) OPERATION(BPL) OPERATION(BRK) OPERATION(BVC) OPERATION(BVS) OPERATION(CLC) OPERATION(CLD) OPERATION(CLI) \
+		OPERATION(CLV) OPERATION(CMP) OPERATION(CPX) OPERATION(CPY) OPERATION(DCP) OPERATION(DEC) OPERATION(DEX) OPERATION(DEY) \
+		OPERATION(EOR) OPERATION(INC) OPERATION(INX) OPERATION(INY) OPERATION(ISB) OPERATION(JMP) OPERATION(JSR) OPERATION(LAX) \
+		OPERATION(LDA) OPERATION(LDX) OPERATION(LDY) OPERATION(LSR) OPERATION(NOP) OPERATION(ORA) OPERATION(PHA) OPERATION(PHP) \
+		OPERATION(PLA) OPERATION(PLP) OPERATION(RLA) OPERATION(ROL) OPERATION(ROR) OPERATION(RRA) OPERATION(RTI) OPERATION(RTS) \
+		OPERATION(SAX) OPERATION(SBC) OPERATION(SEC) OPERATION(SED) OPERATION(SEI) OPERATION(SLO) OPERATION(SRE) OPERATION(STA) \
+		OPERATION(STX) OPERATION(STY) OPERATION(TAX) OPERATION(TAY) OPERATION(TSX) OPERATION(TXA) OPERATION(TXS) OPERATION(TYA) \
+		OPERATION(Unknown)
+
+	enum Operation: unsigned char {
+#define CPU_OPERATION_ENUM(name) op##name,
+		CPU_OPERATIONS(CPU_OPERATION_ENUM)
+#undef CPU_OPERATION_ENUM
+		OperationCount
+	};
+
+	struct Instruction {
+		const char *name; // Mnemonic and addressing mode, padded for the CPU log
+		AddressingMode mode;
+		Operation operation;
+		unsigned char cycles; // Base cycle count
+		bool pageCrossPenalty; // Takes 1 extra cycle when the indexed address crosses a page boundary
+	};
+
+	extern const Instruction instructionTable[256];
 }
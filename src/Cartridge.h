@@ -1,14 +1,19 @@
+#pragma once
+
+#include <vector>
+#include "MappedFile.h"
+
 enum CartRegion {NTSC,PAL,Dual};
 enum FileType {iNESOriginal,iNES,iNES2};
 
 struct Cartridge
 {
 	unsigned char header[16];
-	unsigned char trainer[512];
-	unsigned char PRGROM[0x200000]; // 2kb is the largest ROM size ever found in iNes format, so have this as a hard limit.
-	unsigned char CHRROM[0x80000]; // 512KiB max
-	unsigned char instROM[8192];
-	unsigned char PROM[32];
+	const unsigned char *trainer; // Points into file, or nullptr if the ROM has no trainer
+	MappedFile file; // The ROM file, mapped into memory for as long as the cartridge is loaded
+	const unsigned char *PRGROM; // Points into file
+	const unsigned char *CHRROM; // Points into file, or nullptr if the cartridge has CHR-RAM
+	std::vector<unsigned char> PRGRAM; // PRGRamSize bytes of work RAM, the first 8KiB of which is mapped to $6000-$7FFF
 	FileType fileFormat;
 	int PRGRomSize;
 	int CHRRomSize;
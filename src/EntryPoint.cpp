@@ -1,7 +1,7 @@
 #include <iostream>
-#include "Cartridge.h"
+#include <cstdlib>
 #include "ProjectInfo.h"
-#include "MainSystem.h"
+#include "Frontend.h"
 
 
 int main(int argc, char* argv[]) {
@@ -12,17 +12,115 @@ int main(int argc, char* argv[]) {
     MainSystem emulator;
 
     // See if a ROM has been passed as an argument and attempt to load it if so. if not, just load a default test rom.
-    std::string ROMFileName;
+    std::string ROMFileName = "nestest.nes";
 
-    if (argc == 1) {
-        ROMFileName = "nestest.nes";
-    } else {
-        ROMFileName = std::string(argv[1]);
+    // Options:
+    // --turbo: start in turbo mode (no frame limiter, can also be toggled with tab)
+    // --render-every N: only draw every Nth frame in turbo mode (0 = never draw, default 4)
+    // --show-fps: show emulated frames and CPU instructions per second in the title bar
+    // --rewind-seconds N: how much history to keep for rewinding with backspace (0 = off, default 60)
+    // --rewind-memory N: the most MiB of memory the rewind history can use (default 16)
+    // --record <movie>: record the controller input of every frame to a movie file
+    // --play <movie>: play a movie back in turbo mode, then hand the controller back to the keyboard
+    // --run-ahead N: show the picture N frames ahead of the game, hiding N frames of its input lag (default 0)
+    // --no-sound: don't play the game's sound
+    // --pause-unfocused: stop the game while the window is in the background
+    bool turbo = false;
+    int renderInterval = 4;
+    bool showFrameRate = false;
+    int rewindSeconds = 60;
+    int rewindMemory = 16;
+    std::string recordFileName;
+    std::string playFileName;
+    int runAheadFrames = 0;
+    bool sound = true;
+    bool pauseUnfocused = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = std::string(argv[i]);
+
+        if (argument == "--turbo") {
+            turbo = true;
+        } else if (argument == "--render-every" && i + 1 < argc) {
+            renderInterval = std::atoi(argv[++i]);
+        } else if (argument == "--show-fps") {
+            showFrameRate = true;
+        } else if (argument == "--rewind-seconds" && i + 1 < argc) {
+            rewindSeconds = std::atoi(argv[++i]);
+        } else if (argument == "--rewind-memory" && i + 1 < argc) {
+            rewindMemory = std::atoi(argv[++i]);
+        } else if (argument == "--record" && i + 1 < argc) {
+            recordFileName = argv[++i];
+        } else if (argument == "--play" && i + 1 < argc) {
+            playFileName = argv[++i];
+        } else if (argument == "--run-ahead" && i + 1 < argc) {
+            runAheadFrames = std::atoi(argv[++i]);
+        } else if (argument == "--no-sound") {
+            sound = false;
+        } else if (argument == "--pause-unfocused") {
+            pauseUnfocused = true;
+        } else if (argument.compare(0, 2, "--") == 0) {
+            // Either not an option at all, or one that takes a value given last with nothing after it
+            std::cout << "Error - unknown option or missing value: " << argument << std::endl;
+            std::cout << "Usage: " << argv[0] << " [rom file] [--turbo] [--render-every n] [--show-fps] [--rewind-seconds n] [--rewind-memory MiB] [--record movie] [--play movie] [--run-ahead frames] [--no-sound] [--pause-unfocused]" << std::endl;
+            return EXIT_FAILURE;
+        } else {
+            ROMFileName = argument;
+        }
     }
 
     // Load the ROM file for the emulator to run, if there was no error start running it.
     if (emulator.loadROM(ROMFileName)) {
-        emulator.run();
+        // Movies run from power on, so they have to be set up before the first frame
+        Movie recording;
+        Movie playback;
+
+        if (!playFileName.empty()) {
+            if (!playback.load(playFileName)) {
+                std::cout << "Error - " << playFileName << " is not a movie file." << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            if (!emulator.playMovie(&playback)) {
+                return EXIT_FAILURE;
+            }
+
+            turbo = true;
+        }
+
+        if (!recordFileName.empty()) {
+            recording.clear(emulator.getROMHash());
+            emulator.recordMovie(&recording);
+        }
+
+        // Rewinding would run frames again that a movie has already played or recorded
+        if (!recordFileName.empty() || !playFileName.empty()) {
+            rewindSeconds = 0;
+        }
+
+        emulator.setRunAhead(runAheadFrames);
+
+        Frontend frontend(emulator);
+        frontend.setTurbo(turbo, renderInterval);
+        frontend.setShowFrameRate(showFrameRate);
+        frontend.setRewind(rewindSeconds, rewindMemory);
+        frontend.setSound(sound);
+        frontend.setPauseOnFocusLoss(pauseUnfocused);
+        frontend.run();
+
+#ifdef NESTALGIA_PROFILER
+        emulator.getProfiler().report(std::cout);
+#endif
+
+        if (!recordFileName.empty()) {
+            emulator.recordMovie(nullptr);
+
+            if (recording.save(recordFileName)) {
+                std::cout << "Recorded " << recording.getFrameCount() << " frames to " << recordFileName << std::endl;
+            } else {
+                std::cout << "Error - could not write " << recordFileName << std::endl;
+            }
+        }
     }
 
     return EXIT_SUCCESS;
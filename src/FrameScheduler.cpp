@@ -0,0 +1,44 @@
+#include <thread>
+#include <algorithm>
+#include "FrameScheduler.h"
+
+FrameScheduler::FrameScheduler(double mFrameSeconds) {
+    frameMicroseconds = mFrameSeconds * 1000000;
+    nextFrame = 0;
+    oversleep = 1000; // Start out assuming the worst (a 1ms timer), the average soon settles to what this host does
+}
+
+void FrameScheduler::waitForFrame() {
+    // Too far behind to catch up (the host stalled or can't keep up) - start again from now rather than running a
+    // burst of frames
+    if (now() - nextFrame > frameMicroseconds * 4) {
+        restart();
+    }
+
+    double remaining = nextFrame - now();
+
+    while (remaining > 0) {
+        if (remaining > oversleep) {
+            // Sleep for all but the time the last sleeps have overrun by, and learn from how this one does
+            double request = remaining - oversleep;
+            double start = now();
+            sf::sleep(sf::microseconds((sf::Int64) request));
+            double late = std::min(std::max(now() - start - request, 0.0), frameMicroseconds / 4);
+            oversleep += (late - oversleep) / 16;
+        } else {
+            std::this_thread::yield();
+        }
+
+        remaining = nextFrame - now();
+    }
+
+    nextFrame += frameMicroseconds;
+}
+
+void FrameScheduler::restart() {
+    nextFrame = now();
+}
+
+double FrameScheduler::now() {
+    return (double) clock.getElapsedTime().asMicroseconds();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <SFML/System.hpp>
+
+/*
+ * Runs frames at a steady rate without keeping a core busy. Each frame is due exactly one frame after the last one was
+ * due, not after it actually ran, so lateness doesn't add up.
+ *
+ * Waiting sleeps through most of the time and only yields for what is left at the end. The OS wakes sleeping threads
+ * late by anything from tens of microseconds to a millisecond or so, so the scheduler keeps an average of how late
+ * it's been and wakes up that much early. Frames start within a fraction of a millisecond of when they're due, while
+ * the thread spends nearly all of its time asleep.
+ */
+class FrameScheduler {
+public:
+  explicit FrameScheduler(double mFrameSeconds);
+
+  void waitForFrame(); // Sleep until the next frame is due, then move on to the one after
+
+  void restart(); // Make the next frame due now, after running flat out or being paused
+
+private:
+  sf::Clock clock;
+  double frameMicroseconds;
+  double nextFrame; // When the next frame is due, in microseconds on clock
+  double oversleep; // Average of how late sleeps have woken up, in microseconds
+
+  double now();
+};
@@ -0,0 +1,361 @@
+#include "ProjectInfo.h"
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstring>
+#include "Frontend.h"
+
+// How long before the next frame is due that the window's thread wakes up to look for it, in microseconds
+static const sf::Int64 PresentMargin = 2000;
+
+Frontend::Frontend(MainSystem &mSystem) {
+    emulator = &mSystem;
+    displayTexture = new sf::Texture;
+    displaySprite = new sf::Sprite;
+    displayTexture->create(256, 240);
+    displaySprite->setTexture(*displayTexture);
+    displaySprite->setScale(3, 3);
+    frames = new TripleBuffer(256 * 240 * 4);
+    running = false;
+    hasFocus = true;
+    turbo = false;
+    profileRequested = false;
+    controllerState = 0;
+    rewindHeld = false;
+    showFrameRate = false;
+    pauseOnFocusLoss = false;
+    rewindBuffer = nullptr;
+    audioRing = nullptr;
+    sound = nullptr;
+    frameRate = new sf::Clock;
+    fps = 0;
+    turboRenderInterval = 4;
+    turboFrames = 0;
+    paused = false;
+    lastInstructionCount = 0;
+    lastFrameNumber = 0;
+    lastFrameHash = 0;
+    framePublished = false;
+    playingMovie = false;
+    statsReady = false;
+    statsFrameRate = 0;
+    statsInstructionRate = 0;
+    statsRunAheadLoad = 0;
+    statsAudioRate = 1;
+}
+
+Frontend::~Frontend() {
+    delete displaySprite;
+    delete displayTexture;
+    delete frames;
+    delete frameRate;
+    delete rewindBuffer;
+    setSound(false);
+}
+
+void Frontend::setTurbo(bool enabled, int renderInterval) {
+    turbo = enabled;
+    turboRenderInterval = renderInterval;
+}
+
+void Frontend::setShowFrameRate(bool show) {
+    showFrameRate = show;
+}
+
+void Frontend::setPauseOnFocusLoss(bool pause) {
+    pauseOnFocusLoss = pause;
+}
+
+void Frontend::setRewind(int seconds, int megabytes) {
+    delete rewindBuffer;
+    rewindBuffer = nullptr;
+
+    if (seconds > 0 && megabytes > 0) {
+        rewindBuffer = new RewindBuffer((size_t) megabytes * 1024 * 1024, (size_t) seconds * 60);
+    }
+}
+
+void Frontend::setSound(bool enabled) {
+    if (sound) {
+        sound->stop(); // Waits for SFML's audio thread to finish with the ring
+        emulator->setAudioOutput(nullptr);
+    }
+
+    delete sound;
+    delete audioRing;
+    sound = nullptr;
+    audioRing = nullptr;
+
+    if (enabled) {
+        // Room for about 170ms of sound. The emulator keeps it around half full, a few chunks ahead of the stream.
+        audioRing = new AudioRingBuffer(8192);
+        sound = new SoundOutput(*audioRing);
+    }
+}
+
+void Frontend::updateSound() {
+    if (!sound)
+        return;
+
+    // Turbo makes sound far faster than it can be played, so don't pass any on until it's back to normal speed. There is
+    // none to pass on while paused.
+    bool stopped = turbo || paused;
+    emulator->setAudioOutput(stopped ? nullptr : audioRing);
+
+    if (stopped) {
+        if (sound->getStatus() != sf::SoundStream::Stopped) {
+            sound->stop();
+        }
+    } else if (sound->getStatus() == sf::SoundStream::Stopped) {
+        // Wait for the ring to fill to the level the emulator keeps it at before starting, so that the stream doesn't
+        // start out short
+        if (audioRing->available() >= audioRing->capacity() / 2) {
+            sound->play();
+        }
+    }
+}
+
+void Frontend::runFrame() {
+    if (rewindBuffer && rewindHeld) {
+        // Each state in the history was saved just before a frame ran, so loading the previous one and running it
+        // again shows the frame before the one on screen
+        if (rewindBuffer->pop(rewindState) && emulator->loadState(rewindState.data(), rewindState.size())) {
+            emulator->execute();
+        }
+
+        return;
+    }
+
+    // Update to current controller input
+    if (hasFocus) {
+        emulator->getInput().Update(controllerState);
+    }
+
+    if (rewindBuffer) {
+        emulator->saveState(rewindState);
+        rewindBuffer->push(rewindState);
+    }
+
+    emulator->execute();
+    updateSound();
+
+    // Drop back to normal speed once a movie has finished, and report how it ended so runs can be compared
+    if (playingMovie && !emulator->isPlayingMovie()) {
+        std::cout << "Movie finished, frame hash: " << std::hex << emulator->getPPU().getFrameHash() << std::dec
+                  << std::endl;
+        turbo = false;
+    }
+
+    playingMovie = emulator->isPlayingMovie();
+}
+
+void Frontend::publishFrame() {
+    // Convert the PPU's output to RGBA and hand it to the window. This is only done when the PPU has finished a new
+    // frame that looks different to the last one published.
+    PPU &ppu = emulator->getPPU();
+
+    if (framePublished && ppu.getFrameNumber() == lastFrameNumber)
+        return;
+
+    lastFrameNumber = ppu.getFrameNumber();
+    unsigned long long frameHash = ppu.getFrameHash();
+
+    if (framePublished && frameHash == lastFrameHash)
+        return;
+
+    ppu.draw();
+    std::memcpy(frames->getWriteBuffer(), ppu.pixels, 256 * 240 * 4);
+    frames->publish();
+    lastFrameHash = frameHash;
+    framePublished = true;
+}
+
+bool Frontend::present(sf::RenderWindow &window) {
+    if (!frames->update())
+        return false;
+
+    displayTexture->update(frames->getReadBuffer());
+    window.draw(*displaySprite);
+    window.display();
+    return true;
+}
+
+void Frontend::updateStats() {
+    if (frameRate->getElapsedTime().asMilliseconds() < 1000)
+        return;
+
+    // Report emulated frames and CPU instructions per second of wall clock time
+    double seconds = frameRate->getElapsedTime().asSeconds();
+    unsigned long long instructions = emulator->getInstructionCount();
+    double instructionsPerSecond = (instructions - lastInstructionCount) / seconds;
+    lastInstructionCount = instructions;
+
+    if (turbo) {
+        std::cout << "Turbo: " << (int) (fps / seconds) << " frames per second, "
+                  << (long long) instructionsPerSecond << " instructions per second" << std::endl;
+    }
+
+    statsFrameRate = (int) (fps / seconds);
+    statsInstructionRate = (long long) instructionsPerSecond;
+    statsRunAheadLoad = emulator->getRunAheadLoad();
+    statsAudioRate = emulator->getAudioRateAdjust();
+    statsReady = true;
+
+    frameRate->restart();
+    fps = 0;
+}
+
+void Frontend::updateTitle(sf::RenderWindow &window, const std::string &buildString) {
+    if (!statsReady.exchange(false))
+        return;
+
+    std::ostringstream windowTitle;
+    windowTitle << buildString;
+
+    if (pauseOnFocusLoss && !hasFocus) {
+        windowTitle << " Paused";
+    }
+
+    if (showFrameRate || turbo) {
+        windowTitle << " FPS: " << statsFrameRate << " IPS: " << statsInstructionRate;
+
+        if (audioRing) {
+            windowTitle << " Underruns: " << audioRing->getUnderruns() << " Overruns: " << audioRing->getOverruns()
+                        << " Audio rate: " << std::showpos << std::fixed << std::setprecision(2)
+                        << (statsAudioRate - 1) * 100 << "%" << std::noshowpos;
+        }
+    }
+
+    // Run-ahead costs extra frames of emulation every frame, report how much of the time for a frame it takes
+    if (statsRunAheadLoad > 0) {
+        windowTitle << " Run-ahead: " << (int) (statsRunAheadLoad * 100) << "% of frame";
+    }
+
+    window.setTitle(windowTitle.str());
+}
+
+void Frontend::emulate() {
+    FrameScheduler scheduler(emulator->getFrameDuration());
+    fps = 0;
+    frameRate->restart();
+    lastInstructionCount = emulator->getInstructionCount();
+    emulator->getProfiler().reset();
+
+    while (running) {
+        // F9 prints the profile so far and starts a new one
+        if (profileRequested.exchange(false)) {
+            emulator->getProfiler().report(std::cout);
+            emulator->getProfiler().reset();
+        }
+
+        if (pauseOnFocusLoss && !hasFocus) {
+            // Nothing runs while the window is in the background. Check back now and then to see if it's been brought
+            // to the front again, and carry on from then.
+            if (!paused) {
+                paused = true;
+                updateSound();
+            }
+
+            sf::sleep(sf::milliseconds(20));
+            scheduler.restart();
+            updateStats();
+            continue;
+        }
+
+        paused = false;
+
+        if (turbo) {
+            // Run frames back to back and only publish every Nth one
+            fps++;
+            turboFrames++;
+            runFrame();
+
+            if (turboRenderInterval > 0 && turboFrames % turboRenderInterval == 0) {
+                publishFrame();
+            }
+
+            scheduler.restart(); // Carry on from now when turbo is turned off
+        } else {
+            // Any audio rate drift is taken up by the emulator adjusting how many samples it makes, so the frame rate
+            // itself never has to give
+            scheduler.waitForFrame();
+            fps++;
+            runFrame();
+            publishFrame();
+        }
+
+        updateStats();
+    }
+}
+
+void Frontend::run() {
+    // Get the buildString for the title bar
+    std::ostringstream buildString;
+    buildString << PROJECT_NAME << " " << PROJECT_VERSION << PROJECT_OS << PROJECT_ARCH << " ";
+
+    // Initialize the SFML system and pass the window handle on to the emulator object for further use.
+    sf::RenderWindow window(sf::VideoMode((256 * 3), (240 * 3)), "LegacyNES", sf::Style::Close);
+    window.setTitle(buildString.str());
+
+    std::cout << "Emulator-Start" << std::endl;
+
+    // The emulator runs on a thread of its own and publishes each finished frame. This thread only handles the
+    // window's events and shows the newest frame, so a slow display() or the window being dragged around never holds
+    // up emulation.
+    running = true;
+    emulation = std::thread(&Frontend::emulate, this);
+
+    while (window.isOpen()) {
+
+        // Check window events
+        sf::Event event{};
+
+        while (window.pollEvent(event)) {
+            // Close the window when the close button is clocked
+            if (event.type == sf::Event::Closed) {
+                window.close();
+            }
+
+            if (event.type == sf::Event::GainedFocus) {
+                hasFocus = true;
+            }
+
+            if (event.type == sf::Event::LostFocus) {
+                hasFocus = false;
+                rewindHeld = false;
+            }
+
+            // Tab toggles turbo mode (fast forward)
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Tab) {
+                turbo = !turbo;
+            }
+
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F9) {
+                profileRequested = true;
+            }
+
+        }
+
+        // Read the keyboard here and pass it on, so that all the window's input is handled on this thread
+        if (hasFocus) {
+            controllerState = keymap.GetState();
+            rewindHeld = keymap.Rewind.isPressed();
+        }
+
+        if (window.isOpen() && present(window)) {
+            // The next frame won't be ready for a while, so sleep through most of it rather than checking every
+            // millisecond. Frames can come sooner in turbo, but there's no use showing them any faster.
+            sf::sleep(sf::microseconds((sf::Int64) (emulator->getFrameDuration() * 1000000) - PresentMargin));
+        } else if (pauseOnFocusLoss && !hasFocus) {
+            sf::sleep(sf::milliseconds(20)); // Nothing will be shown until the window is brought back to the front
+        } else {
+            sf::sleep(sf::milliseconds(1)); // Nothing new to show yet
+        }
+
+        updateTitle(window, buildString.str());
+    }
+
+    running = false;
+    emulation.join();
+    emulator->halt();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <SFML/System.hpp>
+#include <SFML/Window.hpp>
+#include <SFML/Graphics.hpp>
+#include "Keymap.h"
+#include "MainSystem.h"
+#include "RewindBuffer.h"
+#include "AudioRingBuffer.h"
+#include "SoundOutput.h"
+#include "TripleBuffer.h"
+#include "FrameScheduler.h"
+
+class Frontend {
+public:
+  explicit Frontend(MainSystem &mSystem);
+
+  ~Frontend();
+
+  void run();
+
+  void setTurbo(bool enabled, int renderInterval); // Runs frames back to back, drawing every renderInterval frames (0 = never draw)
+
+  void setShowFrameRate(bool show);
+
+  void setPauseOnFocusLoss(bool pause); // Stop emulating while the window is in the background
+
+  void setRewind(int seconds, int megabytes); // Keep up to this much history for the rewind key (0 seconds = off)
+
+  void setSound(bool enabled);
+private:
+  MainSystem *emulator;
+  Input::Keymap keymap; // Only used on the window's thread
+  sf::Texture *displayTexture;
+  sf::Sprite *displaySprite;
+  TripleBuffer *frames; // Finished frames on their way from the emulation thread to the window
+  std::thread emulation;
+  std::atomic<bool> running; // Cleared to stop the emulation thread
+  std::atomic<bool> hasFocus; // Does the window have focus or not?
+  std::atomic<bool> turbo; // Turbo mode runs with no frame limiter
+  std::atomic<bool> profileRequested; // F9 was pressed - the emulation thread prints the profile, as it owns it
+  std::atomic<unsigned char> controllerState; // Read from the keyboard by the window's thread
+  std::atomic<bool> rewindHeld;
+  bool showFrameRate;
+  bool pauseOnFocusLoss;
+  RewindBuffer *rewindBuffer; // nullptr when rewinding is off
+  std::vector<unsigned char> rewindState;
+  AudioRingBuffer *audioRing; // Samples on their way from the emulator to sound, nullptr when sound is off
+  SoundOutput *sound;
+
+  // Only used on the emulation thread
+  sf::Clock *frameRate;
+  int fps; // Increment each time the PPU outputs 1 frame
+  int turboRenderInterval;
+  int turboFrames;
+  bool paused; // Stopped for the window being in the background
+  unsigned long long lastInstructionCount;
+  unsigned long long lastFrameNumber; // The PPU frame number and hash of the last frame published
+  unsigned long long lastFrameHash;
+  bool framePublished;
+  bool playingMovie; // A movie was playing at the end of the last frame
+
+  // Worked out once a second by the emulation thread for the title bar, which statsReady says to update
+  std::atomic<bool> statsReady;
+  std::atomic<int> statsFrameRate;
+  std::atomic<long long> statsInstructionRate;
+  std::atomic<double> statsRunAheadLoad;
+  std::atomic<double> statsAudioRate;
+
+  void emulate(); // The emulation thread: run frames at the right times and publish them
+
+  void runFrame(); // Run the next frame, or step back a frame while the rewind key is held
+
+  void publishFrame(); // Pass the PPU's output on to the window, if it has changed
+
+  bool present(sf::RenderWindow &window); // Show the newest frame, false if there is nothing new to show
+
+  void updateSound(); // Start or stop passing sound on to the stream, to suit the current speed
+
+  void updateStats();
+
+  void updateTitle(sf::RenderWindow &window, const std::string &buildString);
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+// 64-bit FNV-1a, used for ROM hashes and for the RAM hashes the headless and batch runners print. Pass the last result
+// back in as hash to carry on over more than one block.
+static const unsigned long long HashStart = 0xCBF29CE484222325ULL;
+
+inline unsigned long long hashBytes(const unsigned char *data, size_t size, unsigned long long hash = HashStart) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+
+    return hash;
+}
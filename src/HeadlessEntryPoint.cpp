@@ -0,0 +1,164 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include "ProjectInfo.h"
+#include "MainSystem.h"
+#include "Hash.h"
+
+static void writeValue(std::ofstream &file, unsigned int value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        file.put((char) ((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static bool writeWAV(const std::string &fileName, const std::vector<short> &sound) {
+    std::ofstream file(fileName, std::ios::binary);
+
+    if (!file)
+        return false;
+
+    unsigned int dataSize = (unsigned int) (sound.size() * 2);
+
+    file.write("RIFF", 4);
+    writeValue(file, 36 + dataSize, 4);
+    file.write("WAVEfmt ", 8);
+    writeValue(file, 16, 4); // Format chunk size
+    writeValue(file, 1, 2); // PCM
+    writeValue(file, 1, 2); // Mono
+    writeValue(file, APU::SampleRate, 4);
+    writeValue(file, APU::SampleRate * 2, 4); // Bytes per second
+    writeValue(file, 2, 2); // Bytes per sample
+    writeValue(file, 16, 2); // Bits per sample
+    file.write("data", 4);
+    writeValue(file, dataSize, 4);
+
+    for (short sample : sound) {
+        writeValue(file, (unsigned short) sample, 2);
+    }
+
+    return file.good();
+}
+
+// Runs a ROM with no window, display or frame limiter - used on machines without a display.
+int main(int argc, char* argv[]) {
+
+    // Print the version string to the console window
+    std::cout<<PROJECT_NAME<<" "<<PROJECT_VERSION<<PROJECT_OS<<PROJECT_ARCH<< " (Compiled: " << __DATE__ << " - " << __TIME__ <<  ") "<< " starting headless..." << std::endl;
+
+    // Options:
+    // --dot-renderer: render the background a pixel at a time instead of a tile at a time (for checking the two match)
+    // --play <movie>: take the controller input from a movie, and run every frame of it unless a frame count is given
+    // --run-ahead N: run N frames ahead every frame as the desktop frontend would, to measure what it costs
+    // --wav <file>: write the sound to a 16-bit mono WAV file
+    std::string ROMFileName;
+    std::string movieFileName;
+    std::string WAVFileName;
+    int frameCount = 600; // 10 seconds of NTSC frames unless told otherwise
+    bool frameCountGiven = false;
+    bool dotRenderer = false;
+    int runAheadFrames = 0;
+    int positionalArguments = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = std::string(argv[i]);
+
+        if (argument == "--dot-renderer") {
+            dotRenderer = true;
+        } else if (argument == "--play" && i + 1 < argc) {
+            movieFileName = argv[++i];
+        } else if (argument == "--wav" && i + 1 < argc) {
+            WAVFileName = argv[++i];
+        } else if (argument == "--run-ahead" && i + 1 < argc) {
+            runAheadFrames = std::atoi(argv[++i]);
+        } else if (positionalArguments++ == 0) {
+            ROMFileName = argument;
+        } else {
+            frameCount = std::atoi(argv[i]);
+            frameCountGiven = true;
+        }
+    }
+
+    if (ROMFileName.empty()) {
+        std::cout << "Usage: " << argv[0] << " <rom file> [frame count] [--dot-renderer] [--play movie] [--run-ahead frames] [--wav file]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    MainSystem emulator;
+
+    if (dotRenderer) {
+        emulator.getPPU().renderer = DotRenderer;
+    }
+
+    if (!emulator.loadROM(ROMFileName)) {
+        return EXIT_FAILURE;
+    }
+
+    Movie movie;
+
+    if (!movieFileName.empty()) {
+        if (!movie.load(movieFileName)) {
+            std::cout << "Error - " << movieFileName << " is not a movie file." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (!emulator.playMovie(&movie)) {
+            return EXIT_FAILURE;
+        }
+
+        if (!frameCountGiven) {
+            frameCount = (int) movie.getFrameCount();
+        }
+    }
+
+    emulator.setRunAhead(runAheadFrames);
+
+    emulator.getProfiler().reset();
+    auto startTime = std::chrono::steady_clock::now();
+    int framesRun = 0;
+    std::vector<short> sound;
+
+    if (WAVFileName.empty()) {
+        framesRun = emulator.runHeadless(frameCount);
+    } else {
+        // Keep each frame's sound as it's made
+        for (; framesRun < frameCount && emulator.isRunning(); framesRun++) {
+            emulator.execute();
+            sound.insert(sound.end(), emulator.getAudio().begin(), emulator.getAudio().end());
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    std::cout << "Ran " << framesRun << " frames in " << elapsed.count() << "s";
+
+    if (elapsed.count() > 0) {
+        std::cout << " (" << framesRun / elapsed.count() << " frames per second, "
+                  << emulator.getInstructionCount() / elapsed.count() << " CPU instructions per second)";
+    }
+
+    std::cout << std::endl;
+
+    if (runAheadFrames > 0) {
+        std::cout << "Running " << runAheadFrames << " frames ahead took " << emulator.getRunAheadLoad() * 100
+                  << "% of each frame's time" << std::endl;
+    }
+
+    // Hashes of the final frame and RAM, for checking that a run went exactly the same way as another
+    unsigned long long RAMHash = hashBytes(emulator.getRAM(), 0x800);
+
+    std::cout << "Frame hash: " << std::hex << std::setfill('0') << std::setw(16) << emulator.getPPU().getFrameHash()
+              << " RAM hash: " << std::setw(16) << RAMHash << std::dec << std::endl;
+
+    if (!WAVFileName.empty() && !writeWAV(WAVFileName, sound)) {
+        std::cout << "Error - could not write " << WAVFileName << std::endl;
+    }
+
+#ifdef NESTALGIA_PROFILER
+    emulator.getProfiler().report(std::cout);
+#endif
+
+    return EXIT_SUCCESS;
+}
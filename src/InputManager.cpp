@@ -1,5 +1,3 @@
-#include <SFML/System.hpp>
-#include <SFML/Graphics.hpp>
 #include <iostream>
 #include "InputManager.h"
 
@@ -10,9 +8,16 @@ InputManager::InputManager() {
   ReadCount[1] = 0;
 }
 
-void InputManager::Update() {
-  // Todo: Later add support for customizable controls
-  controllers[0].Update(); // Update controller 1
+InputManager::~InputManager() {
+
+}
+
+void InputManager::Update(unsigned char state) {
+  controllers[0].Update(state); // Update controller 1
+}
+
+unsigned char InputManager::GetState() {
+  return controllers[0].GetState();
 }
 
 unsigned char InputManager::GetStatus(unsigned short Location) {
@@ -42,6 +47,16 @@ void InputManager::WriteStatus(unsigned short Location) {
   ReadCount[1] = 0;
 }
 
+void InputManager::SaveState(StateWriter &state) {
+  state.write(controllers[0].buttons);
+  state.write(ReadCount);
+}
+
+void InputManager::LoadState(StateReader &state) {
+  state.read(controllers[0].buttons);
+  state.read(ReadCount);
+}
+
 unsigned char InputManager::SetBit(int bit, bool val, unsigned char value) // Used for setting flags to a value which is not the flag register
 {
 	// Sets a specific flag to true or false depending on the value of "val"
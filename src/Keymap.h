@@ -0,0 +1,80 @@
+#pragma once
+
+#include <SFML/Window.hpp>
+
+namespace Input {
+
+enum InputType {iKeyboard,iMouse,iJoystickAxis,iJoystickButton}; // We only support keyboards for now, but will need this later
+
+struct Key {
+  InputType myType;
+  sf::Keyboard::Key keyCode;
+  sf::Mouse::Button mouseButton;
+  int JoystickID;
+  int JoystickButton;
+  int JoystickAxis;
+
+  Key() {
+    // By default, use keyboard controls
+    myType = InputType::iKeyboard;
+  }
+
+  bool isPressed() {
+    if (myType == InputType::iKeyboard) {
+      // Return if the key in question is pressed or not
+      return sf::Keyboard::isKeyPressed(keyCode);
+    }
+
+    return false;
+  }
+};
+
+struct Keymap {
+  Key Up;
+  Key Down;
+  Key Left;
+  Key Right;
+  Key A;
+  Key B;
+  Key Start;
+  Key Select;
+  Key Rewind; // Held to run the game backwards - not a controller button
+
+  Keymap() {
+    // For now, just use the default controls
+    Up.myType = InputType::iKeyboard;
+    Up.keyCode = sf::Keyboard::Up;
+    Down.myType = InputType::iKeyboard;
+    Down.keyCode = sf::Keyboard::Down;
+    Left.myType = InputType::iKeyboard;
+    Left.keyCode = sf::Keyboard::Left;
+    Right.myType = InputType::iKeyboard;
+    Right.keyCode = sf::Keyboard::Right;
+    A.myType = InputType::iKeyboard;
+    A.keyCode = sf::Keyboard::A;
+    B.myType = InputType::iKeyboard;
+    B.keyCode = sf::Keyboard::S;
+    Start.myType = InputType::iKeyboard;
+    Start.keyCode = sf::Keyboard::Return;
+    Select.myType = InputType::iKeyboard;
+    Select.keyCode = sf::Keyboard::Space;
+    Rewind.myType = InputType::iKeyboard;
+    Rewind.keyCode = sf::Keyboard::BackSpace;
+  }
+
+  unsigned char GetState() {
+    // Poll every key and pack the result in the same order as Input::Controller::buttons
+    unsigned char state = 0;
+    state |= A.isPressed() << 0;
+    state |= B.isPressed() << 1;
+    state |= Select.isPressed() << 2;
+    state |= Start.isPressed() << 3;
+    state |= Up.isPressed() << 4;
+    state |= Down.isPressed() << 5;
+    state |= Left.isPressed() << 6;
+    state |= Right.isPressed() << 7;
+    return state;
+  }
+};
+
+};
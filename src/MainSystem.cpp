@@ -1,149 +1,367 @@
-#include "ProjectInfo.h"
-#include <sstream>
 #include <iostream>
-#include "Cartridge.h"
+#include <algorithm>
+#include <chrono>
+#include "ProjectInfo.h"
 #include "MainSystem.h"
+#include "Hash.h"
+
+// PAL Master clock: 21.48MHz, NTSC master clock: 26.60mhz.
+// CPU Clock: Master/12 (NTSC), Master/16 (PAL)
+// Only NTSC is supported right now - will add PAL timings in future.
+static const double MasterClockRate = 21477272;
+static const int MasterClocksPerDot = 4; // The PPU runs at a quarter of the master clock
+
+// The most the sound is sped up or slowed down to keep the audio ring half full, small enough not to be heard
+static const double MaxAudioRateAdjust = 0.005;
 
 MainSystem::MainSystem() {
     mainInput = new InputManager();
     mainPPU = new PPU();
-    mainMemory = new MemoryManager(*mainPPU, *mainInput);
+    mainAPU = new APU();
+    mainMemory = new MemoryManager(*mainPPU, *mainAPU, *mainInput);
     mainCPU = new CPU6502(*mainMemory);
-    frameRate = new sf::Clock;
-    hasFocus = true;
+    profiler = new Profiler();
+    mainCPU->profiler = profiler;
+    mainPPU->profiler = profiler;
+    mainAPU->profiler = profiler;
+    log = &std::cout;
+    stateSize = 0;
+    ROMHash = hashROM();
+    recording = nullptr;
+    playback = nullptr;
+    audioOutput = nullptr;
+    audioFill = 0;
+    audioRateAdjust = 1;
+    playbackFrame = 0;
+    runAheadFrames = 0;
+    runAheadSeconds = 0;
+    runAheadCount = 0;
 }
 
 MainSystem::~MainSystem() {
-
+    delete mainCPU;
+    delete mainMemory;
+    delete mainPPU;
+    delete mainAPU;
+    delete mainInput;
+    delete profiler;
 }
 
 void MainSystem::reset() {
-    frameRate->restart();
+    // reset the CPU, PPU and APU in preparation to start
+    mainCPU->Reset();
+    mainPPU->reset();
+    mainAPU->reset();
 }
 
 void MainSystem::execute() {
     // This function executes 1 frame of emulation.
+#ifdef NESTALGIA_PROFILER
+    ProfileScope scope(profiler, ProfileCPU); // Everything not charged to another part of the system is the CPU's
+    profiler->countFrame();
+#endif
+
+    // Movies set or record the controller state once per frame, before the frame runs
+    if (playback) {
+        mainInput->Update(playback->getFrame(playbackFrame++));
 
-    // PAL Master clock: 21.48MHz, NTSC master clock: 26.60mhz.
-    // CPU Clock: Master/12 (NTSC), Master/16 (PAL)
-    // Only NTSC is supported right now - will add PAL timings in future.
-    const double MasterClocksPerFrame = 21477272 / 60;
-    int ClocksThisFrame = 0;
+        if (playbackFrame >= playback->getFrameCount())
+            playback = nullptr;
+    }
+
+    if (recording) {
+        recording->addFrame(mainInput->GetState());
+    }
 
-    // Update to current controller input
-    if (hasFocus) {
-        mainInput->Update();
+    runFrame();
+
+    // Hand the sound over before running ahead, which makes none of its own. Never waits: if the ring is full, the
+    // samples that don't fit are dropped and counted.
+    if (audioOutput) {
+        const std::vector<short> &samples = mainAPU->getSamples();
+        audioOutput->write(samples.data(), samples.size());
+
+        // Dynamic rate control: the sound card's clock never quite matches the host's, so make slightly more sound per
+        // frame while the ring is less than half full and slightly less while it's more. The fill level jumps about as
+        // the sound card takes whole chunks, so steer by an average of it.
+        double halfFull = audioOutput->capacity() / 2.0;
+        audioFill += (audioOutput->available() - audioFill) / 32;
+        double error = std::max(-1.0, std::min(1.0, (audioFill - halfFull) / halfFull));
+        audioRateAdjust = 1 - error * MaxAudioRateAdjust;
+        mainAPU->setRateAdjust(audioRateAdjust);
     }
 
-    // Loop through all of the machine clicks that we need to
-    while ((ClocksThisFrame < MasterClocksPerFrame) && mainCPU->state == CPUState::Running) {
+    if (runAheadFrames > 0 && isRunning()) {
+        // Run ahead: remember where the game really is, run on with the same input and keep the picture of the last
+        // frame, then go back. The game sees input as soon as it would have if it reacted to it with no lag.
+        auto startTime = std::chrono::steady_clock::now();
+        saveState(runAheadState);
+        mainAPU->silent = true; // The real frame has already made this frame's sound
 
+        for (int i = 0; i < runAheadFrames && isRunning(); i++) {
+            runFrame();
+        }
+
+        mainAPU->silent = false;
+        loadState(runAheadState.data(), runAheadState.size());
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        runAheadSeconds += elapsed.count();
+        runAheadCount++;
+    }
+}
 
-        int CPUCycles = mainCPU->Execute(); // CPU's clock speed is MasterClockSpeed/12
+void MainSystem::runFrame() {
+    // A frame runs until the PPU finishes the next one, so that each call shows exactly one new picture
+    unsigned long long frameNumber = mainPPU->getFrameNumber();
 
+    // Run the CPU in batches rather than one instruction at a time. Each batch ends at VBLANK, where the PPU finishes its
+    // frame, or at the next IRQ from the APU or mapper, whichever comes first.
+    while (mainPPU->getFrameNumber() == frameNumber && mainCPU->state == CPUState::Running) {
+        int cycleBudget = mainPPU->cyclesUntilVBlank();
+        cycleBudget = std::min(cycleBudget, mainMemory->cyclesUntilIRQ());
 
-        mainPPU->execute(CPUCycles * 3); // PPU's clock is 3x the CPU's
+        mainMemory->scheduleChanged = false;
+        mainCPU->Run(cycleBudget);
 
-        int machineClocks = CPUCycles * 12;
+        // The PPU only runs when the CPU touches it, so bring it up to date before checking for VBLANK
+        mainMemory->syncPPU();
 
         if (mainPPU->NMIFired) {
-            // If this is true, the PPU wants to send an NMI to the CPU
+            // The PPU wants to send an NMI to the CPU. NMIs are edge triggered, so clear the request once it is passed on
             mainCPU->FireInterrupt(CPUInterrupt::iNMI);
-        }
-
-        if (mainCPU->interruptProcessed && mainPPU->NMIFired) {
-            // an NMI has been triggered and dealt withm so reset the PPU's request
             mainPPU->NMIFired = false;
-            mainCPU->interruptProcessed = false;
         }
-
-
-        ClocksThisFrame += machineClocks;
-
     }
 
-
+    mainMemory->endAudioFrame();
 }
 
 bool MainSystem::loadROM(std::string fileName) {
-    if (mainMemory->loadFile(fileName) == 0) {
+    stateSize = 0; // States from the last ROM are a different size
+    int result = mainMemory->loadFile(fileName);
+    ROMHash = hashROM(); // Worked out once here, as every savestate is stamped with it
+
+    if (result == 0) {
         reset();
-        execute();
         return true;
     } else {
-        std::cout << "Error loading ROM file - aborting..." << std::endl;
+        *log << "Error loading ROM file - aborting..." << std::endl;
         return false;
     }
 }
 
-void MainSystem::run() {
-    // Get the buildString for the title bar
-    std::ostringstream buildString;
-    buildString << PROJECT_NAME << " " << PROJECT_VERSION << PROJECT_OS << PROJECT_ARCH << " ";
+int MainSystem::runHeadless(int frameCount) {
+    // Run frames back to back as fast as the host allows - there is no display to wait for.
+    int frames = 0;
 
-    // Initialize the SFML system and pass the window handle on to the emulator object for further use.
-    sf::RenderWindow window(sf::VideoMode((256 * 3), (240 * 3)), "LegacyNES", sf::Style::Close);
-    window.setFramerateLimit(60);
-    window.setTitle(buildString.str());
+    while (frames < frameCount && isRunning()) {
+        execute();
+        frames++;
+    }
 
-    // Working in milliseconds (Multiplier 2x makes it run at 60fps, will have to look into the timing issues when more roms run.)
-    // TODO: Will need to work on the timing when emulator is more complete. for some reason frame rate is showing 30fps unless I put 120 here.
-    const double oneFrame = 1000/120;
-    sf::Clock frameTime;
-    fps = 0;
+    return frames;
+}
 
-    // reset the CPU, PPU and APU in preparation to start
-    std::cout << "Emulator-Start" << std::endl;
-    mainCPU->Reset();
-    mainPPU->reset();
+bool MainSystem::isRunning() {
+    return mainCPU->state == CPUState::Running;
+}
+
+void MainSystem::halt() {
+    mainCPU->state = CPUState::Halt;
+}
 
+unsigned long long MainSystem::getInstructionCount() {
+    return mainCPU->GetInstructionCount();
+}
 
-    // This will be the emulator's main loop
-    while (window.isOpen()) {
+void MainSystem::setLog(std::ostream &stream) {
+    // Each instance can log somewhere different, so several can run side by side without their output mixing
+    log = &stream;
+    mainMemory->log = &stream;
+    mainCPU->log = &stream;
+}
 
-        // Check window events
-        sf::Event event{};
+const unsigned char *MainSystem::getRAM() {
+    return mainMemory->getRAM();
+}
 
-        while (window.pollEvent(event)) {
-            // Close the window when the close button is clocked
-            if (event.type == sf::Event::Closed) {
-                mainCPU->state = CPUState::Halt;
-                window.close();
-            }
+void MainSystem::saveState(std::vector<uint8_t> &buffer) {
+    // The state starts with a header identifying the version and the ROM it belongs to, followed by each part of the
+    // system in turn. Reusing the buffer means there's nothing to allocate after the first call.
+#ifdef NESTALGIA_PROFILER
+    ProfileScope scope(profiler, ProfileSaveState);
+#endif
+    buffer.clear();
+    StateWriter state(buffer);
 
-            if (event.type == sf::Event::GainedFocus) {
-                hasFocus = true;
-            }
+    // Bring the PPU and APU up to date, so that the state is of a single point in time
+    mainMemory->syncPPU();
+    mainMemory->syncAPU();
 
-            if (event.type == sf::Event::LostFocus) {
-                hasFocus = false;
-            }
+    state.write(SaveStateMagic);
+    state.write(SaveStateVersion);
 
-        }
+    state.write(ROMHash);
 
-        // Update the emulator once per frame
-        if (frameTime.getElapsedTime().asMilliseconds() >= oneFrame) {
-            fps++;
-            execute();
-            frameTime.restart();
-        }
+    mainCPU->SaveState(state);
+    mainMemory->saveState(state);
+    mainPPU->saveState(state);
+    mainAPU->saveState(state);
+    mainInput->SaveState(state);
 
-        mainPPU->draw(window); // Update the display output at the end of the frame
-        window.display();
+    stateSize = buffer.size();
+}
 
-        // Set the window title to display the frame rate
-        if (frameRate->getElapsedTime().asMilliseconds() >= 1000) {
-            std::ostringstream windowTitle;
-            windowTitle << buildString.str();
+bool MainSystem::loadState(const uint8_t *data, size_t size) {
+    // Check everything that could make the state unusable before changing anything: it has to be from this version,
+    // for this ROM, and the size a state of this ROM always is
+#ifdef NESTALGIA_PROFILER
+    ProfileScope scope(profiler, ProfileSaveState);
+#endif
+    StateReader state(data, size);
+    unsigned int magic = 0;
+    unsigned int version = 0;
+    unsigned long long hash = 0;
+
+    state.read(magic);
+    state.read(version);
+    state.read(hash);
+
+    if (state.failed || magic != SaveStateMagic || version != SaveStateVersion) {
+        *log << "Error - not a savestate from this version of " << PROJECT_NAME << std::endl;
+        return false;
+    }
 
-            if (false) { // TODO: Allow this to be configured in a config file or something.
-                windowTitle << " FPS: " << fps;
-            }
+    // The hash covers the whole ROM - many games share the same iNES header
+    if (hash != ROMHash) {
+        *log << "Error - savestate is for a different ROM" << std::endl;
+        return false;
+    }
 
-            window.setTitle(windowTitle.str());
-            frameRate->restart();
-            fps = 0;
-        }
+    // Keep the machine as it is now, to go back to if the state turns out to be damaged. This also gives the size a
+    // state of this ROM should be.
+    saveState(scratchState);
 
+    if (size != stateSize) {
+        *log << "Error - savestate is the wrong size (" << size << " bytes, expected " << stateSize << ")" << std::endl;
+        return false;
     }
+
+    // Bank offsets and PPU positions can only be checked as each part reads them, so a part may already have been
+    // changed by the time one turns out to be out of range
+    if (!applyState(state)) {
+        StateReader previous(scratchState.data(), scratchState.size());
+        previous.readBytes(sizeof(magic) + sizeof(version) + sizeof(hash));
+        applyState(previous);
+
+        *log << "Error - savestate is damaged" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool MainSystem::applyState(StateReader &state) {
+    // Reads each part of the system from a state whose header has already been read
+    mainCPU->LoadState(state);
+    mainMemory->loadState(state);
+    mainPPU->loadState(state);
+    mainAPU->loadState(state);
+    mainInput->LoadState(state);
+
+    return !state.failed;
+}
+
+unsigned long long MainSystem::getROMHash() {
+    return ROMHash;
+}
+
+unsigned long long MainSystem::hashROM() {
+    // 64-bit FNV-1a of the header, PRG-ROM and CHR-ROM
+    Cartridge *cartridge = mainMemory->cartridge;
+    unsigned long long hash = HashStart;
+
+    if (!cartridge)
+        return hash;
+
+    hash = hashBytes(cartridge->header, 16, hash);
+    hash = hashBytes(cartridge->PRGROM, cartridge->PRGRomSize, hash);
+
+    if (cartridge->CHRROM) {
+        hash = hashBytes(cartridge->CHRROM, cartridge->CHRRomSize, hash);
+    }
+
+    return hash;
+}
+
+void MainSystem::recordMovie(Movie *movie) {
+    recording = movie;
+}
+
+bool MainSystem::playMovie(Movie *movie) {
+    if (movie && movie->getROMHash() != getROMHash()) {
+        *log << "Error - movie was recorded on a different ROM" << std::endl;
+        return false;
+    }
+
+    playback = (movie && movie->getFrameCount() > 0) ? movie : nullptr;
+    playbackFrame = 0;
+    return true;
+}
+
+bool MainSystem::isPlayingMovie() {
+    return playback != nullptr;
+}
+
+void MainSystem::setRunAhead(int frames) {
+    runAheadFrames = std::max(0, frames);
+    runAheadSeconds = 0;
+    runAheadCount = 0;
+}
+
+double MainSystem::getRunAheadLoad() {
+    double load = 0;
+
+    if (runAheadCount > 0) {
+        load = (runAheadSeconds / runAheadCount) / getFrameDuration();
+    }
+
+    runAheadSeconds = 0;
+    runAheadCount = 0;
+    return load;
+}
+
+Profiler &MainSystem::getProfiler() {
+    return *profiler;
+}
+
+InputManager &MainSystem::getInput() {
+    return *mainInput;
+}
+
+const std::vector<short> &MainSystem::getAudio() {
+    return mainAPU->getSamples();
+}
+
+void MainSystem::setAudioOutput(AudioRingBuffer *ring) {
+    if (ring != audioOutput) {
+        audioFill = ring ? ring->capacity() / 2.0 : 0;
+        audioRateAdjust = 1;
+        mainAPU->setRateAdjust(1);
+    }
+
+    audioOutput = ring;
+}
+
+double MainSystem::getAudioRateAdjust() {
+    return audioRateAdjust;
+}
+
+double MainSystem::getFrameDuration() {
+    return mainPPU->getDotsPerFrame() * MasterClocksPerDot / MasterClockRate;
+}
+
+PPU &MainSystem::getPPU() {
+    return *mainPPU;
 }
@@ -1,10 +1,18 @@
-#include <SFML/System.hpp>
-#include <SFML/Window.hpp>
-#include <SFML/Graphics.hpp>
+#pragma once
+
+#include <string>
+#include <iosfwd>
+#include <vector>
+#include <cstdint>
+#include "Cartridge.h"
 #include "InputManager.h"
 #include "PPU.h"
+#include "APU.h"
 #include "MemoryManager.h"
 #include "CPU6502.h"
+#include "Movie.h"
+#include "Profiler.h"
+#include "AudioRingBuffer.h"
 
 class MainSystem {
 public:
@@ -18,13 +26,74 @@ public:
 
   void reset();
 
-  void run();
+  int runHeadless(int frameCount); // Runs up to frameCount frames back to back with no display, returns the number of frames run
+
+  bool isRunning();
+
+  void halt();
+
+  unsigned long long getInstructionCount(); // CPU instructions executed since the ROM was reset
+
+  void setLog(std::ostream &stream); // Send the core's messages somewhere other than std::cout
+
+  const unsigned char *getRAM(); // The 2KiB of internal RAM
+
+  void saveState(std::vector<uint8_t> &buffer); // Replaces the buffer's contents with a savestate. Call between frames.
+
+  // Returns false, leaving the machine as it was, if the state is from another ROM or version, is the wrong size, or
+  // has a bank offset or PPU position out of range
+  bool loadState(const uint8_t *data, size_t size);
+
+  unsigned long long getROMHash(); // Identifies the loaded ROM's contents, for checking movies are played on the right ROM
+
+  void recordMovie(Movie *movie); // Add the controller state of every frame from now on to the movie, nullptr to stop
+
+  bool playMovie(Movie *movie); // Take the controller state from the movie instead of getInput(), false if it's for another ROM
+
+  bool isPlayingMovie(); // Stays true until every frame of the movie has run
+
+  void setRunAhead(int frames); // Show the picture from this many frames ahead to hide the game's input lag (0 = off)
+
+  double getRunAheadLoad(); // Share of a frame's time spent running ahead, averaged since the last call
+
+  Profiler &getProfiler(); // Only collects anything when NESTALGIA_PROFILER is defined
+
+  InputManager &getInput();
+
+  PPU &getPPU();
+
+  const std::vector<short> &getAudio(); // The 48kHz mono samples made by the last frame
+
+  void setAudioOutput(AudioRingBuffer *ring); // Write every frame's samples into the ring as it finishes, nullptr to stop
+
+  double getAudioRateAdjust(); // How much faster or slower than normal the sound is being made to keep the ring half full
+
+  double getFrameDuration(); // Seconds of the NES's time from one frame to the next, the time execute() runs for
 private:
   InputManager *mainInput;
   MemoryManager *mainMemory;
   CPU6502 *mainCPU;
   PPU *mainPPU;
-  sf::Clock *frameRate;
-  int fps; // Increment each time the PPU outputs 1 frame
-  bool hasFocus; // Does the window have focus or not?
+  APU *mainAPU;
+  Profiler *profiler;
+  std::ostream *log;
+  unsigned long long ROMHash; // getROMHash() of the loaded ROM
+  size_t stateSize; // Size of a savestate for the loaded ROM, or 0 if one hasn't been made yet
+  std::vector<uint8_t> scratchState; // The machine as it was before the last loadState()
+  Movie *recording;
+  Movie *playback;
+  AudioRingBuffer *audioOutput;
+  double audioFill; // Average number of samples in audioOutput after each frame
+  double audioRateAdjust;
+  size_t playbackFrame; // The next frame of playback to run
+  int runAheadFrames;
+  std::vector<uint8_t> runAheadState;
+  double runAheadSeconds; // Time spent running ahead since getRunAheadLoad() was last called
+  int runAheadCount; // Frames that ran ahead since getRunAheadLoad() was last called
+
+  void runFrame();
+
+  bool applyState(StateReader &state);
+
+  unsigned long long hashROM();
 };
@@ -0,0 +1,111 @@
+#include <fstream>
+#include <iterator>
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile() {
+    view = nullptr;
+    length = 0;
+    mapped = false;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string &fileName) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (mapping) {
+            // The view keeps the mapping alive, so both handles can be closed straight away
+            view = (const unsigned char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+
+        if (view) {
+            length = (size_t) fileSize.QuadPart;
+            mapped = true;
+        }
+    }
+
+    CloseHandle(file);
+#else
+    int file = ::open(fileName.c_str(), O_RDONLY);
+
+    if (file < 0)
+        return false;
+
+    struct stat fileStat;
+
+    if (fstat(file, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+        void *address = mmap(nullptr, (size_t) fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        if (address != MAP_FAILED) {
+            view = (const unsigned char *) address;
+            length = (size_t) fileStat.st_size;
+            mapped = true;
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(file);
+#endif
+
+    if (mapped)
+        return true;
+
+    // Empty files, pipes and the like can't be mapped - read them the ordinary way
+    std::ifstream stream(fileName, std::ios::binary);
+
+    if (!stream)
+        return false;
+
+    fallbackData.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    view = fallbackData.data();
+    length = fallbackData.size();
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(view);
+#else
+        munmap((void *) view, length);
+#endif
+    }
+
+    fallbackData.clear();
+    view = nullptr;
+    length = 0;
+    mapped = false;
+}
+
+const unsigned char *MappedFile::data() const {
+    return view;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*
+ * A read-only view of a whole file. The file is memory-mapped where the OS allows it, so opening it doesn't copy
+ * anything - pages are only read in from disk (or the page cache) when they're touched. Files that can't be mapped are
+ * read into memory in one go instead, so callers never need to care which happened.
+ */
+class MappedFile {
+public:
+    MappedFile();
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &fileName); // Returns false if the file couldn't be opened
+
+    void close();
+
+    const unsigned char *data() const;
+
+    size_t size() const;
+
+private:
+    const unsigned char *view; // Start of the mapping, or of fallbackData
+    size_t length;
+    bool mapped; // True if view needs unmapping
+    std::vector<unsigned char> fallbackData; // The file's contents when it couldn't be mapped
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <ostream>
+#include "SaveState.h"
+
+// Nametable layouts. The first two match bit 0 of the iNES header's flags 6.
+enum NameTableMirroring {
+    HorizontalMirroring, // $2000 = $2400, $2800 = $2C00
+    VerticalMirroring, // $2000 = $2800, $2400 = $2C00
+    SingleScreenLower, // Every nametable is the first one
+    SingleScreenUpper, // Every nametable is the second one
+    FourScreen // Extra nametable RAM on the cartridge, nothing is mirrored
+};
+
+/*
+ * Base class for the cartridge hardware that decides which parts of PRG-ROM and CHR are visible to the CPU and PPU.
+ *
+ * Mappers never copy ROM data about when switching banks. They only update the bank tables below, which the
+ * MemoryManager and PPU read from after every write to the mapper.
+ */
+class Mapper {
+public:
+    const unsigned char *PRGBanks[4]; // 8KiB PRG-ROM banks mapped to $8000, $A000, $C000 and $E000
+    int CHRBanks[8]; // Offsets into CHR memory of the 1KiB banks mapped to PPU $0000-$1FFF
+    int mirroring; // Current NameTableMirroring
+    bool IRQLine; // True while the mapper is asserting the CPU's IRQ line
+
+    explicit Mapper(Cartridge &mCartridge);
+
+    virtual ~Mapper();
+
+    virtual void reset(); // Put the banks back into their power on state
+
+    virtual void writeRegister(unsigned short location, unsigned char value); // CPU write to $8000-$FFFF
+
+    virtual void clockScanline(); // Called by the PPU once per rendered scanline (when PPU A12 rises on real hardware)
+
+    virtual int scanlinesUntilIRQ(); // clockScanline() calls before the mapper raises an IRQ, or -1 if it won't
+
+    virtual void saveState(StateWriter &state); // Write the bank tables and any registers the mapper has
+
+    virtual void loadState(StateReader &state); // Read back what saveState() wrote
+
+protected:
+    Cartridge *cartridge;
+    int PRGBankCount; // Number of 8KiB PRG-ROM banks
+    int CHRBankCount; // Number of 1KiB CHR banks
+
+    // Map the given bank number (in units of the bank size) to a slot (in units of the bank size). Bank numbers that are
+    // too high wrap around, as they do on the real cartridges.
+    void setPRGBank8K(int slot, int bank);
+
+    void setPRGBank16K(int slot, int bank);
+
+    void setPRGBank32K(int bank);
+
+    void setCHRBank1K(int slot, int bank);
+
+    void setCHRBank2K(int slot, int bank);
+
+    void setCHRBank4K(int slot, int bank);
+
+    void setCHRBank8K(int bank);
+};
+
+// Mapper 0
+class NROM : public Mapper {
+public:
+    explicit NROM(Cartridge &mCartridge);
+};
+
+// Mapper 1
+class MMC1 : public Mapper {
+public:
+    explicit MMC1(Cartridge &mCartridge);
+
+    void reset() override;
+
+    void writeRegister(unsigned short location, unsigned char value) override;
+
+    void saveState(StateWriter &state) override;
+
+    void loadState(StateReader &state) override;
+
+private:
+    unsigned char shiftRegister;
+    int shiftCount;
+    unsigned char control;
+    unsigned char CHRBank0;
+    unsigned char CHRBank1;
+    unsigned char PRGBank;
+
+    void updateBanks();
+};
+
+// Mapper 2
+class UxROM : public Mapper {
+public:
+    explicit UxROM(Cartridge &mCartridge);
+
+    void reset() override;
+
+    void writeRegister(unsigned short location, unsigned char value) override;
+};
+
+// Mapper 3
+class CNROM : public Mapper {
+public:
+    explicit CNROM(Cartridge &mCartridge);
+
+    void writeRegister(unsigned short location, unsigned char value) override;
+};
+
+// Mapper 4
+class MMC3 : public Mapper {
+public:
+    explicit MMC3(Cartridge &mCartridge);
+
+    void reset() override;
+
+    void writeRegister(unsigned short location, unsigned char value) override;
+
+    void clockScanline() override;
+
+    int scanlinesUntilIRQ() override;
+
+    void saveState(StateWriter &state) override;
+
+    void loadState(StateReader &state) override;
+
+private:
+    unsigned char bankSelect;
+    unsigned char bankRegisters[8];
+    unsigned char IRQLatch;
+    unsigned char IRQCounter;
+    bool IRQReload;
+    bool IRQEnabled;
+
+    void updateBanks();
+};
+
+// Mapper 7
+class AxROM : public Mapper {
+public:
+    explicit AxROM(Cartridge &mCartridge);
+
+    void reset() override;
+
+    void writeRegister(unsigned short location, unsigned char value) override;
+};
+
+// Creates the mapper for the cartridge's mapper number, or returns nullptr if it isn't supported
+Mapper *createMapper(Cartridge &cartridge, std::ostream &log);
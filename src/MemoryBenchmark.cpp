@@ -0,0 +1,74 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include "ProjectInfo.h"
+#include "Cartridge.h"
+#include "PPU.h"
+#include "APU.h"
+#include "InputManager.h"
+#include "MemoryManager.h"
+
+// The way internal RAM used to be stored: a 64KiB array holding every mirror, with each write reduced to the first
+// 2KiB by a loop and then stored into all four mirrors. Kept here as the baseline to measure against.
+static unsigned char mirroredMemory[0x10000];
+
+static void writeMirroredRAM(unsigned short location, unsigned char value) {
+    while (location > 0x07FF) {
+        location -= 0x800;
+    }
+
+    mirroredMemory[location] = value;
+    mirroredMemory[location + 0x800] = value;
+    mirroredMemory[location + 0x1000] = value;
+    mirroredMemory[location + 0x1800] = value;
+}
+
+static unsigned char readMirroredRAM(unsigned short location) {
+    return mirroredMemory[location];
+}
+
+// Times alternating writes and reads spread over $0000-$1FFF, the pattern of stack pushes and zero page accesses
+int main(int argc, char* argv[]) {
+    std::cout<<PROJECT_NAME<<" "<<PROJECT_VERSION<<PROJECT_OS<<PROJECT_ARCH<< " (Compiled: " << __DATE__ << " - " << __TIME__ <<  ") "<< " memory benchmark" << std::endl;
+
+    // Options:
+    // [passes]: how many times to go over the whole of $0000-$1FFF (default 20000)
+    int passes = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+    PPU ppu;
+    APU apu;
+    InputManager input;
+    MemoryManager memory(ppu, apu, input);
+    long long pairs = (long long) passes * 0x2000;
+    unsigned int check = 0; // Printed so that the reads can't be optimised away
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (int pass = 0; pass < passes; pass++) {
+        for (unsigned int location = 0; location < 0x2000; location++) {
+            // Step through the addresses out of order, so that every mirror is hit throughout
+            unsigned short address = (unsigned short) ((location * 0x301) & 0x1FFF);
+            writeMirroredRAM(address, (unsigned char) (pass + location));
+            check += readMirroredRAM((unsigned short) (address ^ 0x1800));
+        }
+    }
+
+    std::chrono::duration<double> mirroredTime = std::chrono::steady_clock::now() - startTime;
+    startTime = std::chrono::steady_clock::now();
+
+    for (int pass = 0; pass < passes; pass++) {
+        for (unsigned int location = 0; location < 0x2000; location++) {
+            unsigned short address = (unsigned short) ((location * 0x301) & 0x1FFF);
+            memory.writeMemory(address, (unsigned char) (pass + location));
+            check += memory.readMemory((unsigned short) (address ^ 0x1800));
+        }
+    }
+
+    std::chrono::duration<double> RAMTime = std::chrono::steady_clock::now() - startTime;
+
+    std::cout << "Four mirrors in 64KiB: " << mirroredTime.count() / pairs * 1e9 << "ns per write and read" << std::endl;
+    std::cout << "2KiB RAM:              " << RAMTime.count() / pairs * 1e9 << "ns per write and read" << std::endl;
+    std::cout << "(check " << check << ")" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -1,29 +1,26 @@
 
 #include <iostream>
-#include <SFML/System.hpp>
-#include <SFML/Window.hpp>
-#include <SFML/Graphics.hpp>
 #include "Cartridge.h"
+#include "Mapper.h"
 #include "PPU.h"
+#include "APU.h"
 #include "InputManager.h"
 #include "MemoryManager.h"
-#include <fstream>
-#include <sstream>
-#include <sys/stat.h>
-#include <sys/types.h>
 #include <cstdlib>
 #include <algorithm>
-#include <vector>
-#include <iterator>
 #include <assert.h>
+#include <climits>
 
-MemoryManager::MemoryManager(PPU &mPPU, InputManager &mInput) {
-    mapper = MemoryMapper::Test;
+MemoryManager::MemoryManager(PPU &mPPU, APU &mAPU, InputManager &mInput) {
+    mapper = nullptr;
+    log = &std::cout;
     ppu = &mPPU; // Store a reference to the passed-on PPU object
+    apu = &mAPU;
+    apu->memory = this; // The DMC reads its samples through the CPU's memory map
     inputManager = &mInput;
     cartridge = nullptr;
 
-    for (unsigned char &i : memory) {
+    for (unsigned char &i : RAM) {
         i = 0x0;
     }
 
@@ -34,109 +31,189 @@ MemoryManager::MemoryManager(PPU &mPPU, InputManager &mInput) {
     IRQLine = false;
 
     writeDMA = false;
+    scheduleChanged = false;
+    cycleCount = 0;
+
+    updatePageTable();
 }
 
 bool MemoryManager::checkIRQ() {
-    return IRQLine;
+    return IRQLine || (mapper && mapper->IRQLine) || apu->IRQLine;
 }
 
 bool MemoryManager::checkNMI() {
     return NMILine;
 }
 
+void MemoryManager::clock(int cpuCycles) {
+    // Advance the bus's clock by the given number of CPU cycles. The PPU is only caught up when something needs it.
+    cycleCount += cpuCycles;
+}
+
+void MemoryManager::syncPPU() {
+    ppu->catchUp(cycleCount);
+}
+
+void MemoryManager::syncAPU() {
+    apu->catchUp(cycleCount);
+}
+
+void MemoryManager::endAudioFrame() {
+    apu->endFrame(cycleCount);
+}
+
+int MemoryManager::cyclesUntilIRQ() {
+    // The number of CPU cycles until the APU or the cartridge will next raise an IRQ. Mappers count scanlines, so ask
+    // the PPU how long those will take to draw.
+    int cycles = apu->cyclesUntilIRQ(cycleCount);
+
+    if (!mapper)
+        return cycles;
+
+    int scanlines = mapper->scanlinesUntilIRQ();
+
+    if (scanlines < 0)
+        return cycles;
+
+    return std::min(cycles, ppu->cyclesUntilScanlineClock(scanlines));
+}
+
+const unsigned char *MemoryManager::getRAM() {
+    return RAM;
+}
+
+void MemoryManager::saveState(StateWriter &state) {
+    state.write(RAM);
+    state.write(cycleCount);
+    state.write(IRQLine);
+    state.write(NMILine);
+    state.write(writeDMA);
+
+    if (cartridge) {
+        state.write(cartridge->PRGRAM.data(), cartridge->PRGRAM.size());
+    }
+
+    if (mapper) {
+        mapper->saveState(state);
+    }
+}
+
+void MemoryManager::loadState(StateReader &state) {
+    state.read(RAM);
+    state.read(cycleCount);
+    state.read(IRQLine);
+    state.read(NMILine);
+    state.read(writeDMA);
+
+    if (cartridge) {
+        state.read(cartridge->PRGRAM.data(), cartridge->PRGRAM.size());
+    }
+
+    if (mapper) {
+        mapper->loadState(state);
+
+        // Point the memory map and the PPU at the banks the mapper had selected
+        updateMapperBanks();
+    }
+}
+
 MemoryManager::~MemoryManager() {
+    delete mapper;
     delete cartridge;
 }
 
 int MemoryManager::loadFile(std::string fileName) {
-    // Delete the cartridge instance if it already exists to free RAM.
+    // Delete the cartridge instance if it already exists. Nothing may point into its ROM file once it's gone.
+    delete mapper;
+    mapper = nullptr;
+    ppu->mapper = nullptr;
+    ppu->loadCHR(nullptr, 0);
+
     if (cartridge) {
         delete cartridge;
     }
 
+    cartridge = nullptr;
+    updatePageTable();
+
     cartridge = new Cartridge();
 
     // Attempt to load the file..
-    std::cout << "Loading file: " << fileName << std::endl;
-
-    // Make sure the ROM exists and check its size
-    struct stat fileStat;
-    int filestat = stat(fileName.c_str(), &fileStat);
+    *log << "Loading file: " << fileName << std::endl;
 
-    if (filestat == 0) {
-        int ROMSize = fileStat.st_size;
-
-        if (ROMSize > 2630191) {
-            // ROM file too large - abort
-            std::cout << "Error - ROM file is too large (" << ROMSize << ") bytes" << std::endl;
-            return -1;
-        } else {
-            std::cout << ROMSize << " byte ROM found..." << std::endl;
-        }
-    } else {
+    // Map the ROM into memory rather than reading it - PRG-ROM and CHR-ROM are used straight from the mapping
+    if (!cartridge->file.open(fileName)) {
         // File not found - abort
-        std::cout << "Error - " << fileName << " not found." << std::endl;
+        *log << "Error - " << fileName << " not found." << std::endl;
         return -1;
     }
 
-    // If we've gotten this far, there are no problems with the rom (yet), so continue to load...
-    typedef std::istream_iterator<unsigned char> istream_iterator;
+    const unsigned char *ROMData = cartridge->file.data();
+    size_t ROMSize = cartridge->file.size();
 
-    std::ifstream romStream(fileName, std::ios::binary); // file stream for reading file contents
-    std::vector<unsigned char> tempStorage; // temporary storage for data - will be copied into cartridge struct later
+    if (ROMSize < 16) {
+        *log << "Error - ROM file is too small (" << ROMSize << ") bytes" << std::endl;
+        return -1;
+    }
 
-    romStream >> std::noskipws; // Do not skip white space, we want every single character of the file.
-    std::copy(istream_iterator(romStream), istream_iterator(),
-              std::back_inserter(tempStorage)); // Copy the contents of the file into the temporary storage vector
+    *log << ROMSize << " byte ROM found..." << std::endl;
 
     // Figure out which kind of iNES file we're dealing with here
-    if (tempStorage[7] == 0x08 && tempStorage[0x0C] == 0x08) {
-        std::cout << "iNES 2.0 format detected" << std::endl;
+    if (ROMData[7] == 0x08 && ROMData[0x0C] == 0x08) {
+        *log << "iNES 2.0 format detected" << std::endl;
         cartridge->fileFormat = FileType::iNES2;
-    } else if (tempStorage[7] == 0x00 && tempStorage[0x0C] == 0x00 &&
-               (tempStorage[12] + tempStorage[13] + tempStorage[14] + tempStorage[15]) == 0) {
-        std::cout << "iNES 0.7 format detected" << std::endl;
+    } else if (ROMData[7] == 0x00 && ROMData[0x0C] == 0x00 &&
+               (ROMData[12] + ROMData[13] + ROMData[14] + ROMData[15]) == 0) {
+        *log << "iNES 0.7 format detected" << std::endl;
         cartridge->fileFormat = FileType::iNES;
     } else {
-        std::cout << "Original iNES format detected" << std::endl;
+        *log << "Original iNES format detected" << std::endl;
         cartridge->fileFormat = FileType::iNESOriginal;
     }
 
     // Copy the 16-byte header into the appropriate section in the Cartridge
-    for (int i = 0; i <= 15; i++) {
-        cartridge->header[i] = tempStorage[i];
-    }
+    std::copy(ROMData, ROMData + 16, cartridge->header);
 
     // Check the cartridge type before continuing
     if (checkCartridge(*cartridge) != 0) {
         return -1;
-    } else {
-
-        // Trainers are currently ignored - will need to add support for them when the program is more functional.
+    }
 
-        // Load the PRG_ROM into the correct location
-        const int FileOffset = 16 + (512 * cartridge->trainerPresent);
-        int PRGOffset = 0;
+    // Trainers are currently ignored - will need to add support for them when the program is more functional.
+    const size_t FileOffset = 16 + (512 * cartridge->trainerPresent);
+    const size_t CHRFileOffset = FileOffset + cartridge->PRGRomSize;
 
-        while (PRGOffset < cartridge->PRGRomSize) {
-            cartridge->PRGROM[PRGOffset] = tempStorage[FileOffset + PRGOffset];
-            PRGOffset++;
-        }
+    if (ROMSize < CHRFileOffset + cartridge->CHRRomSize) {
+        *log << "Error - ROM file is truncated, expected " << (CHRFileOffset + cartridge->CHRRomSize)
+                  << " bytes" << std::endl;
+        return -1;
+    }
 
-        // Load the CHR_ROM into the correct location
-        const int CHRFileOffset = FileOffset + (cartridge->PRGRomSize);
+    if (cartridge->PRGRomSize == 0) {
+        *log << "Error - ROM has no PRG_ROM" << std::endl;
+        return -1;
+    }
 
-        int CHROffset = 0;
+    // Point the cartridge at its ROM inside the file, and let the PPU build its tile cache from the CHR-ROM. Only the
+    // cartridge's RAM needs allocating, at the size the header asks for.
+    cartridge->trainer = cartridge->trainerPresent ? ROMData + 16 : nullptr;
+    cartridge->PRGROM = ROMData + FileOffset;
+    cartridge->CHRROM = cartridge->CHRRomSize > 0 ? ROMData + CHRFileOffset : nullptr;
+    ppu->loadCHR(cartridge->CHRROM, cartridge->CHRRomSize);
+    cartridge->PRGRAM.assign(cartridge->PRGRamSize, 0);
 
-        while (CHROffset < cartridge->CHRRomSize) {
-            cartridge->CHRROM[CHROffset] = tempStorage[(CHRFileOffset + CHROffset)];
-            ppu->writeCROM(CHROffset, cartridge->CHRROM[CHROffset]); // Copy the values into the PPU's character memory
+    // Set up the cartridge's mapper, which decides where the ROM data appears
+    mapper = createMapper(*cartridge, *log);
 
-            CHROffset++;
-        }
+    if (!mapper) {
+        *log << "Error - mapper " << std::dec << cartridge->mapper << " is not supported." << std::endl;
+        return -1;
     }
 
-    std::cout << "ROM File loaded successfully." << std::endl;
+    ppu->mapper = mapper;
+    updatePageTable();
+
+    *log << "ROM File loaded successfully." << std::endl;
     return 0;
 }
 
@@ -148,46 +225,43 @@ bool MemoryManager::getBit(int bit, unsigned char value) {
 int MemoryManager::checkCartridge(Cartridge &cartridge) {
     switch (cartridge.fileFormat) {
         case FileType::iNES2:
-            std::cout << "Error: Support for iNES2.0 not yet implemented." << std::endl;
+            *log << "Error: Support for iNES2.0 not yet implemented." << std::endl;
             return -1;
         case FileType::iNES: {
             // Print text if the appropriate header text is found at the start of the ROM - if not perhaps print out a warning later.
             if (cartridge.header[0] == 0x4E && cartridge.header[1] == 0x45 && cartridge.header[2] == 0x53 &&
                 cartridge.header[3] == 0x1A) {
-                std::cout << "NES ROM header Found" << std::endl;
+                *log << "NES ROM header Found" << std::endl;
             }
 
             // Find out if there is a trainer attached to the ROM or not
             cartridge.trainerPresent = ((cartridge.header[6] >> 1) & 1);
 
             if (cartridge.trainerPresent) {
-                std::cout << "ROM has a trainer attached." << std::endl;
+                *log << "ROM has a trainer attached." << std::endl;
             } else {
-                std::cout << "ROM does not have a trainer attached." << std::endl;
+                *log << "ROM does not have a trainer attached." << std::endl;
             }
 
-            // Check which vertical mirroring mode the ROM uses
-            ppu->nameTableMirrorMode = getBit(0, cartridge.header[6]);
-
-            // Remove bits we don't care about from both...
-            unsigned char upper = cartridge.header[6] >> 4;
+            // The mapper number is split across the top nibbles of flags 6 (low nibble) and 7 (high nibble)
+            unsigned char upper = cartridge.header[7] >> 4;
             unsigned char lower = cartridge.header[6] >> 4;
             unsigned short mapper = (upper << 4) + lower;
 
             cartridge.mapper = mapper;
 
-            std::cout << "mapper found: " << std::dec << (int) mapper << std::endl;
+            *log << "mapper found: " << std::dec << (int) mapper << std::endl;
             // Get the size of the PRG_ROM
             cartridge.PRGRomSize = (16384 * cartridge.header[4]);
-            std::cout << "PRG_ROM Size: " << std::dec << (int) cartridge.PRGRomSize << "bytes" << std::endl;
+            *log << "PRG_ROM Size: " << std::dec << (int) cartridge.PRGRomSize << "bytes" << std::endl;
 
             // Get the size of the CHRRom
             cartridge.CHRRomSize = (8192 * cartridge.header[5]);
-            std::cout << "CHR_ROM Size: " << std::dec << (int) cartridge.CHRRomSize << "bytes" << std::endl;
+            *log << "CHR_ROM Size: " << std::dec << (int) cartridge.CHRRomSize << "bytes" << std::endl;
 
             if (cartridge.header[5] == 0) {
                 ppu->CHRRAM = true;
-                std::cout << "Cartridge uses CHR_RAM" << std::endl;
+                *log << "Cartridge uses CHR_RAM" << std::endl;
             } else {
                 ppu->CHRRAM = false;
             }
@@ -197,42 +271,43 @@ int MemoryManager::checkCartridge(Cartridge &cartridge) {
             if (cartridge.PRGRamSize == 0)
                 cartridge.PRGRamSize = 8192;
 
-            std::cout << "PRG_RAM Size: " << std::dec << (int) cartridge.PRGRamSize << "bytes" << std::endl;
+            *log << "PRG_RAM Size: " << std::dec << (int) cartridge.PRGRamSize << "bytes" << std::endl;
 
             // Detect cartridge region
             unsigned char tmpregion = cartridge.header[10] << 6;
 
             tmpregion = tmpregion >> 6;
 
-            std::cout << "Cartridge region: ";
+            *log << "Cartridge region: ";
 
             if (tmpregion == 0) {
                 cartridge.region = CartRegion::NTSC;
-                std::cout << "NTSC" << std::endl;
+                *log << "NTSC" << std::endl;
             } else if (tmpregion == 2) {
                 cartridge.region = CartRegion::PAL;
-                std::cout << "PAL" << std::endl;
+                *log << "PAL" << std::endl;
             } else {
                 cartridge.region = CartRegion::Dual;
-                std::cout << "Dual" << std::endl;
+                *log << "Dual" << std::endl;
             }
 
             return 0; // Cartridge is processed and checked out - continue to load
         }
         case FileType::iNESOriginal:
-            std::cout << "Error: Support for original iNES format not yet implemented." << std::endl;
+            *log << "Error: Support for original iNES format not yet implemented." << std::endl;
             return -1;
         default:
-            std::cout << "Error: Unsupported file format" << std::endl;
+            *log << "Error: Unsupported file format" << std::endl;
             return -1;
     }
 }
 
-void MemoryManager::writeMemory(unsigned short location, unsigned char value) {
-    // There are no memory mappers emulated at the moment in this version of this emulator - this function is a lot simpler than it eventually will be
-    // Currently still working on the CPU for the most part.
-
+void MemoryManager::updatePageTable() {
     /*
+    Builds the table readMemory() and writeMemory() use to find each 256 byte page of the CPU's address space. Pages that
+    are plain memory get a pointer straight to it, everything else gets a handler function. Needs to be called again
+    whenever the cartridge changes what is mapped where.
+
     NES Memory Map:
     0000-07FF: RAM (+ Mirrored RAM)
     2000-3FFF: PPU Registers (Mirrored every 8 bytes)
@@ -240,121 +315,114 @@ void MemoryManager::writeMemory(unsigned short location, unsigned char value) {
     4018-401F: APU + I/O Functionality (usually disabled)
     4020-FFFF: Cartridge (All ROM + RAM chips on cartridge as well as other hardware)
     */
-#ifdef DISPLAYMEMACTIVITY
-    if (location <= 0xFF)
-        std::cout<<"      WRITE     $00"<<std::hex<<location<<" = $"<<(int)value<<std::endl;
-    else
-        std::cout<<"      WRITE     $"<<std::hex<<location<<" = $"<<(int)value<<std::endl;
-#endif
-
-    if ((location >= 0x2000) && (location <= 0x3FFF)) {
-        writePPU(location, value);
+    for (int page = 0; page < 0x100; page++) {
+        readPages[page] = nullptr;
+        writePages[page] = nullptr;
+        readHandlers[page] = &MemoryManager::readCartridge;
+        writeHandlers[page] = &MemoryManager::writeCartridge;
     }
 
-    if (location == 0x4014) {
-        // PPU OAM DMA
-        OAMDMA(value);
+    // 0000-07FF is the 2KiB of RAM, and 0800-1FFF mirrors it three times. All of the mirrors point to the same memory.
+    for (int page = 0x00; page < 0x20; page++) {
+        readPages[page] = &RAM[(page << 8) & 0x7FF];
+        writePages[page] = &RAM[(page << 8) & 0x7FF];
     }
 
-    if (location == 0x4016) {
-        inputManager->WriteStatus(location);
+    for (int page = 0x20; page < 0x40; page++) {
+        readHandlers[page] = &MemoryManager::readPPU;
+        writeHandlers[page] = &MemoryManager::writePPU;
     }
 
-    if (location >= 0x4020)
-        writeCartridge(location, value);
+    readHandlers[0x40] = &MemoryManager::readIO;
+    writeHandlers[0x40] = &MemoryManager::writeIO;
 
-    if (location <= 0x1FFF)
-        writeRAM(location, value); // CPU is trying to write to RAM, so handle this here...
+    if (cartridge && cartridge->PRGRAM.size() >= 0x2000) {
+        // Work RAM on the cartridge
+        for (int page = 0x60; page < 0x80; page++) {
+            readPages[page] = &cartridge->PRGRAM[(page - 0x60) << 8];
+            writePages[page] = &cartridge->PRGRAM[(page - 0x60) << 8];
+        }
+    }
+
+    updateMapperBanks();
 }
 
-void MemoryManager::writeCartridge(unsigned short location, unsigned char value) {
-    // Write to the cartridge - depending on the mapper being used this process will vary
-    // Only available for cartridges which include RAM on them.
+void MemoryManager::updateMapperBanks() {
+    // Point the PRG-ROM pages at the banks the mapper has selected, and pass its CHR banks and mirroring on to the PPU.
+    // Writes to $8000-$FFFF always go to the mapper's registers.
+    if (!mapper)
+        return;
 
-    switch (cartridge->mapper) {
-        default:
-            return; // Return if no mapper here matches the cartridge - you can't write to an NROM cart as they include no RAM.
+    for (int page = 0x80; page < 0x100; page++) {
+        readPages[page] = mapper->PRGBanks[(page - 0x80) >> 5] + ((page & 0x1F) << 8);
     }
+
+    ppu->setCHRBanks(mapper->CHRBanks);
+    ppu->setMirroring(mapper->mirroring);
 }
 
-unsigned char MemoryManager::readCartridge(unsigned short location) {
-    // Read from the cartridge - depending on the mapper being used this process will vary
-    switch (cartridge->mapper) {
-        case 0:
-            return readNROM(location);
-        default:
-            std::cout << "CPU tried to read using an unsupported mapper (Why/how is the emulator even running?)"
-                      << std::endl;
-            return 0x0;
+unsigned char MemoryManager::readIO(unsigned short location) {
+    // Joypad registers
+    if (location == 0x4016 || location == 0x4017) {
+        return inputManager->GetStatus(location);
     }
-}
 
-void MemoryManager::writeRAM(unsigned short location, unsigned char value) {
-    /* Handle RAM mirroring and RAM writes here.
-         RAM Map:
-         0000-07FF - 8Kb RAM
-         0800-0FFF - Mirrored RAM 0
-         1000-17FF - Mirrored RAM 1
-         1800-1FFF - Mirrored RAM 2
-    */
+    if (location == 0x4015) {
+        scheduleChanged = true; // Reading the status acknowledges the frame IRQ, so the next one is a frame away
+        return apu->readStatus(cycleCount);
+    }
 
-    // Reduce the location value to its "base" value, and then we can write them all at once to all mirrored locations.
-    while (location > 0x07FF) {
-        location -= 0x800; // This could be done in a nicer way with no loop - perhaps fix later.
+    if (location >= 0x4020) {
+        return readCartridge(location);
     }
 
-#ifdef TestingRAMWrapping
-    std::cout<<"$"<<std::hex<<(int)location<<" = "<<(int) value<<std::endl;
-    std::cout<<"$"<<std::hex<<(int)location+0x800<<" = "<<(int) value<<std::endl;
-    std::cout<<"$"<<std::hex<<(int)location+0x1000<<" = "<<(int) value<<std::endl;
-    std::cout<<"$"<<std::hex<<(int)location+0x1800<<" = "<<(int) value<<std::endl;
-#endif
-
-    // We have the base location, so write it.
-    memory[location] = value;
-    memory[0x800 + location] = value;
-    memory[0x1000 + location] = value;
-    memory[0x1800 + location] = value;
+    return 0x0;
 }
 
-unsigned char MemoryManager::readMemory(unsigned short location) {
-    /*
-    NES Memory Map:
-    0000-1FFF: RAM (+ Mirrored RAM)
-    2000-3FFF: PPU registers (Mirrored every 8 bytes)
-    4000-4017: APU + I/O registers
-    4018-401F: APU + I/O Functionality (usually disabled)
-    4020-FFFF: Cartridge (All ROM + RAM chips on cartridge as well as other hardware)
-    */
-
-#ifdef DISPLAYMEMACTIVITY
-    if (location <= 0xFF)
-        std::cout<<"      READ      $00"<<std::hex<<location<<std::endl;
-    else
-        std::cout<<"      READ      $"<<std::hex<<location<<std::endl;
-#endif
-
-    if (location <= 0x1FFF) {
-        return memory[location];
+void MemoryManager::writeIO(unsigned short location, unsigned char value) {
+    if (location == 0x4014) {
+        // PPU OAM DMA
+        OAMDMA(value);
     }
 
-    if ((location >= 0x2000) && (location <= 0x3FFF)) {
-        return readPPU(location);
+    if (location == 0x4016) {
+        inputManager->WriteStatus(location);
     }
 
-    // Joypad registers
-    if (location == 0x4016 || location == 0x4017) {
-        return inputManager->GetStatus(location);
-    }
+    if (location <= 0x4013 || location == 0x4015 || location == 0x4017) {
+        apu->writeRegister(location, value, cycleCount);
 
-    if (location >= 0x4020) {
-        return readCartridge(location);
+        // The frame counter and DMC registers move the APU's next IRQ
+        if (location == 0x4010 || location == 0x4015 || location == 0x4017)
+            scheduleChanged = true;
     }
 
+    if (location >= 0x4020)
+        writeCartridge(location, value);
+}
+
+void MemoryManager::writeCartridge(unsigned short location, unsigned char value) {
+    // Writes to $8000-$FFFF go to the mapper. Anything below that which isn't cartridge RAM is ignored.
+    if (!mapper || location < 0x8000)
+        return;
+
+    // The PPU has to finish drawing with the old CHR banks and mirroring before they change, and the DMC has to fetch
+    // any samples due before now from the old PRG banks
+    syncPPU();
+    syncAPU();
+
+    mapper->writeRegister(location, value);
+    updateMapperBanks();
+    scheduleChanged = true; // The mapper's IRQ may have been moved
+}
+
+unsigned char MemoryManager::readCartridge(unsigned short /*location*/) {
+    // Cartridge space with nothing mapped to it
     return 0x0;
 }
 
 unsigned char MemoryManager::readPPU(unsigned short location) {
+    syncPPU(); // The CPU is about to see the PPU's state, so make sure it's up to date
     location &= 0x2007;
     unsigned short dbglocation = location;
     location -= 0x2000; // There are 8 PPU registers to read/write, so we can easily find out which one here
@@ -366,10 +434,15 @@ unsigned char MemoryManager::readPPU(unsigned short location) {
 
 void MemoryManager::writePPU(unsigned short location, unsigned char value) {
     // Writes to the PPU's registers
+    syncPPU(); // Everything the PPU has drawn up to now has to be drawn with the old register values
     location &= 0x2007;
 
     location -= 0x2000; // There are 8 PPU registers to read/write, so we can easily find out which one here
     ppu->writeRegister(location, value);
+
+    // PPUCTRL and PPUMASK turn NMIs and rendering on and off, which can move the next NMI or mapper IRQ
+    if (location <= 1)
+        scheduleChanged = true;
 }
 
 // These need access to the current MemoryManager state, so delare them as class functions
@@ -435,6 +508,8 @@ void MemoryManager::OAMDMA(unsigned char location) {
     // Writes all 256 bytes within the given main memory page to the PPU's object attribute memory. The CPU should be halted for 513 CPU cycles.
     unsigned short MemLocation = location << 8; // location gives the high byte of a memory page
 
+    syncPPU();
+
     for (int i = 0; i <= 0xFF; i++) {
         // Copy each one of the 256 bytes into the PPU's OAM array
         unsigned char writelocation = i + ppu->OAMAddress;
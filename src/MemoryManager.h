@@ -1,7 +1,11 @@
 #pragma once
-enum MemoryMapper {
-    None, Test
-};
+
+#include <iosfwd>
+#include "SaveState.h"
+
+class Mapper;
+class APU;
+
 enum HeaderData {
     Const0, Const1, Const2, Const3, PROMSize, CROMSize, Flags6, Flags7, PRAMSize, Flags9, Flags10, Null
 };
@@ -11,8 +15,10 @@ public:
     bool pageBoundaryPassed; // Holds true if the previous indirect memory operation passed a page boundary, reset otherwise.
     Cartridge *cartridge;
     bool writeDMA;
+    bool scheduleChanged; // Set when a write may have changed when the next NMI or IRQ happens - ends the CPU's batch
+    std::ostream *log; // Where messages about loading ROMs are written
 
-    MemoryManager(PPU &mPPU, InputManager &mInput);
+    MemoryManager(PPU &mPPU, APU &mAPU, InputManager &mInput);
 
     ~MemoryManager();
 
@@ -22,6 +28,10 @@ public:
 
     void writeMemory(unsigned short location, unsigned char value);
 
+    void updatePageTable(); // Rebuild the memory map after the cartridge changes what is mapped where
+
+    void updateMapperBanks(); // Update the PRG-ROM pages and the PPU's CHR banks after the mapper switches banks
+
     unsigned short IN(unsigned char lo, unsigned char hi);
 
     unsigned short INdX(unsigned char rX, unsigned char location);
@@ -40,15 +50,41 @@ public:
 
     bool checkNMI();
 
+    void clock(int cpuCycles);
+
+    void syncPPU(); // Catch the PPU up to the current CPU cycle
+
+    void syncAPU(); // Catch the APU up to the current CPU cycle
+
+    void endAudioFrame(); // Have the APU turn the sound up to the current CPU cycle into samples
+
+    int cyclesUntilIRQ();
+
+    const unsigned char *getRAM(); // The 2KiB of internal RAM
+
+    void saveState(StateWriter &state); // Write RAM, the bus's clock and interrupt lines, and the mapper's state
+
+    void loadState(StateReader &state);
+
 private:
-    unsigned char memory[0xFFFF];
+    typedef unsigned char (MemoryManager::*ReadHandler)(unsigned short location);
+    typedef void (MemoryManager::*WriteHandler)(unsigned short location, unsigned char value);
+
+    // Memory map, one entry per 256 byte page. Pages that can be accessed directly have a pointer to their memory,
+    // the rest (nullptr) are passed on to their handler.
+    const unsigned char *readPages[0x100];
+    unsigned char *writePages[0x100];
+    ReadHandler readHandlers[0x100];
+    WriteHandler writeHandlers[0x100];
+
+    unsigned char RAM[0x800]; // The NES's 2KiB of internal RAM
     bool IRQLine;
     bool NMILine;
     InputManager *inputManager;
     PPU *ppu;
-    MemoryMapper mapper;
-
-    void writeRAM(unsigned short location, unsigned char value);
+    APU *apu;
+    Mapper *mapper;
+    unsigned long long cycleCount; // CPU cycles clocked since power on
 
     void writeCartridge(unsigned short location, unsigned char value);
 
@@ -60,12 +96,48 @@ private:
 
     unsigned char readPPU(unsigned short location);
 
+    unsigned char readIO(unsigned short location);
+
+    void writeIO(unsigned short location, unsigned char value);
+
     void writePPU(unsigned short location, unsigned char value);
 
     int checkCartridge(Cartridge &cartridge);
 
     bool getBit(int bit, unsigned char value);
-
-    // mapper functions
-    unsigned char readNROM(unsigned short location);
 };
+
+inline unsigned char MemoryManager::readMemory(unsigned short location) {
+#ifdef DISPLAYMEMACTIVITY
+    if (location <= 0xFF)
+        std::cout<<"      READ      $00"<<std::hex<<location<<std::endl;
+    else
+        std::cout<<"      READ      $"<<std::hex<<location<<std::endl;
+#endif
+
+    const unsigned char *page = readPages[location >> 8];
+
+    if (page) {
+        return page[location & 0xFF];
+    }
+
+    return (this->*readHandlers[location >> 8])(location);
+}
+
+inline void MemoryManager::writeMemory(unsigned short location, unsigned char value) {
+#ifdef DISPLAYMEMACTIVITY
+    if (location <= 0xFF)
+        std::cout<<"      WRITE     $00"<<std::hex<<location<<" = $"<<(int)value<<std::endl;
+    else
+        std::cout<<"      WRITE     $"<<std::hex<<location<<" = $"<<(int)value<<std::endl;
+#endif
+
+    unsigned char *page = writePages[location >> 8];
+
+    if (page) {
+        page[location & 0xFF] = value;
+        return;
+    }
+
+    (this->*writeHandlers[location >> 8])(location, value);
+}
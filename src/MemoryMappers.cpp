@@ -1,25 +1,500 @@
 #include <iostream>
-#include <SFML/System.hpp>
-#include <SFML/Window.hpp>
-#include <SFML/Graphics.hpp>
+#include <algorithm>
 #include "Cartridge.h"
-#include "PPU.h"
-#include "InputManager.h"
-#include "MemoryManager.h"
-
-// Functions for reading from specific memory mappers go here.
-unsigned char MemoryManager::readNROM(unsigned short location)
-{
-  // 0x8000 = Cartridge byte 0
-  // 0xC000 = Cartridge byte 0
-
-  // Handle the mirroring (Reading from 0xC000 is the same as reading from 0x8000) in NROM-128
-  //if (location > 0xBFFF)
-    //location -= 0x4000;
-  if (cartridge->header[4] == 1)
-      location&=0xBFFF;
-
-    location-=0x8000;
-  // Return the actual data from the cartridge array
-  return cartridge->PRGROM[location];
+#include "Mapper.h"
+
+// The cartridge mappers. Each one only decides which banks of PRG-ROM and CHR are visible where - the MemoryManager and
+// PPU do the reading and writing through the bank tables.
+
+Mapper::Mapper(Cartridge &mCartridge) {
+    cartridge = &mCartridge;
+    PRGBankCount = std::max(1, cartridge->PRGRomSize / 0x2000);
+
+    // Cartridges without CHR-ROM have 8KiB of CHR-RAM instead
+    CHRBankCount = cartridge->CHRRomSize > 0 ? cartridge->CHRRomSize / 0x400 : 8;
+
+    if (cartridge->header[6] & 0x08) {
+        mirroring = NameTableMirroring::FourScreen;
+    } else {
+        mirroring = cartridge->header[6] & 1;
+    }
+
+    IRQLine = false;
+
+    for (const unsigned char *&i : PRGBanks) {
+        i = cartridge->PRGROM;
+    }
+
+    for (int &i : CHRBanks) {
+        i = 0;
+    }
+}
+
+Mapper::~Mapper() {
+
+}
+
+void Mapper::reset() {
+    setPRGBank32K(0);
+    setCHRBank8K(0);
+}
+
+void Mapper::writeRegister(unsigned short /*location*/, unsigned char /*value*/) {
+    // Plain ROM carts have no registers to write to
+}
+
+void Mapper::clockScanline() {
+
+}
+
+int Mapper::scanlinesUntilIRQ() {
+    return -1;
+}
+
+void Mapper::saveState(StateWriter &state) {
+    // PRG banks are saved as offsets into PRG-ROM, as the ROM won't be at the same address next time
+    for (const unsigned char *bank : PRGBanks) {
+        state.write((int) (bank - cartridge->PRGROM));
+    }
+
+    state.write(CHRBanks);
+    state.write(mirroring);
+    state.write(IRQLine);
+}
+
+void Mapper::loadState(StateReader &state) {
+    int PRGOffsets[4];
+    int CHROffsets[8];
+
+    state.read(PRGOffsets);
+    state.read(CHROffsets);
+    state.read(mirroring);
+    state.read(IRQLine);
+
+    // Don't let a damaged state point the banks outside of the cartridge
+    for (int i = 0; i < 4; i++) {
+        if (PRGOffsets[i] < 0 || PRGOffsets[i] > (PRGBankCount - 1) * 0x2000)
+            state.failed = true;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        if (CHROffsets[i] < 0 || CHROffsets[i] > (CHRBankCount - 1) * 0x400)
+            state.failed = true;
+    }
+
+    if (state.failed)
+        return;
+
+    for (int i = 0; i < 4; i++) {
+        PRGBanks[i] = cartridge->PRGROM + PRGOffsets[i];
+    }
+
+    for (int i = 0; i < 8; i++) {
+        CHRBanks[i] = CHROffsets[i];
+    }
+}
+
+void Mapper::setPRGBank8K(int slot, int bank) {
+    bank %= PRGBankCount;
+
+    if (bank < 0)
+        bank += PRGBankCount;
+
+    PRGBanks[slot] = &cartridge->PRGROM[bank * 0x2000];
+}
+
+void Mapper::setPRGBank16K(int slot, int bank) {
+    setPRGBank8K(slot * 2, bank * 2);
+    setPRGBank8K((slot * 2) + 1, (bank * 2) + 1);
+}
+
+void Mapper::setPRGBank32K(int bank) {
+    for (int i = 0; i < 4; i++) {
+        setPRGBank8K(i, (bank * 4) + i);
+    }
+}
+
+void Mapper::setCHRBank1K(int slot, int bank) {
+    bank %= CHRBankCount;
+
+    if (bank < 0)
+        bank += CHRBankCount;
+
+    CHRBanks[slot] = bank * 0x400;
+}
+
+void Mapper::setCHRBank2K(int slot, int bank) {
+    setCHRBank1K(slot * 2, bank * 2);
+    setCHRBank1K((slot * 2) + 1, (bank * 2) + 1);
+}
+
+void Mapper::setCHRBank4K(int slot, int bank) {
+    for (int i = 0; i < 4; i++) {
+        setCHRBank1K((slot * 4) + i, (bank * 4) + i);
+    }
+}
+
+void Mapper::setCHRBank8K(int bank) {
+    for (int i = 0; i < 8; i++) {
+        setCHRBank1K(i, (bank * 8) + i);
+    }
+}
+
+// NROM: 16 or 32KiB of PRG-ROM (16KiB carts appear twice) and 8KiB of CHR, no bank switching
+NROM::NROM(Cartridge &mCartridge) : Mapper(mCartridge) {
+
+}
+
+// MMC1: Registers are written a bit at a time through a 5-bit shift register
+MMC1::MMC1(Cartridge &mCartridge) : Mapper(mCartridge) {
+    shiftRegister = 0;
+    shiftCount = 0;
+    control = 0x0C;
+    CHRBank0 = 0;
+    CHRBank1 = 0;
+    PRGBank = 0;
+}
+
+void MMC1::reset() {
+    shiftRegister = 0;
+    shiftCount = 0;
+    control = 0x0C; // Start with the last PRG bank fixed at $C000, so the reset vector can be found
+    CHRBank0 = 0;
+    CHRBank1 = 0;
+    PRGBank = 0;
+    updateBanks();
+}
+
+void MMC1::writeRegister(unsigned short location, unsigned char value) {
+    if (value & 0x80) {
+        // Writing with bit 7 set clears the shift register and goes back to the power on PRG mode
+        shiftRegister = 0;
+        shiftCount = 0;
+        control |= 0x0C;
+        updateBanks();
+        return;
+    }
+
+    shiftRegister = (shiftRegister >> 1) | ((value & 1) << 4);
+    shiftCount++;
+
+    if (shiftCount < 5)
+        return;
+
+    // The fifth write copies the shift register to the register selected by the address of that write
+    switch ((location >> 13) & 3) {
+        case 0:
+            control = shiftRegister;
+            break;
+        case 1:
+            CHRBank0 = shiftRegister;
+            break;
+        case 2:
+            CHRBank1 = shiftRegister;
+            break;
+        case 3:
+            PRGBank = shiftRegister;
+            break;
+    }
+
+    shiftRegister = 0;
+    shiftCount = 0;
+    updateBanks();
+}
+
+void MMC1::saveState(StateWriter &state) {
+    Mapper::saveState(state);
+    state.write(shiftRegister);
+    state.write(shiftCount);
+    state.write(control);
+    state.write(CHRBank0);
+    state.write(CHRBank1);
+    state.write(PRGBank);
+}
+
+void MMC1::loadState(StateReader &state) {
+    Mapper::loadState(state);
+    state.read(shiftRegister);
+    state.read(shiftCount);
+    state.read(control);
+    state.read(CHRBank0);
+    state.read(CHRBank1);
+    state.read(PRGBank);
+}
+
+void MMC1::updateBanks() {
+    switch (control & 3) {
+        case 0:
+            mirroring = NameTableMirroring::SingleScreenLower;
+            break;
+        case 1:
+            mirroring = NameTableMirroring::SingleScreenUpper;
+            break;
+        case 2:
+            mirroring = NameTableMirroring::VerticalMirroring;
+            break;
+        case 3:
+            mirroring = NameTableMirroring::HorizontalMirroring;
+            break;
+    }
+
+    // 512KiB carts (SUROM) use bit 4 of the CHR bank register to pick which 256KiB half of PRG-ROM is visible
+    int outerBank = 0;
+
+    if (PRGBankCount > 32 && (CHRBank0 & 0x10))
+        outerBank = 16;
+
+    switch ((control >> 2) & 3) {
+        case 0:
+        case 1:
+            // Switch 32KiB at $8000, ignoring the low bit of the bank number
+            setPRGBank16K(0, outerBank + (PRGBank & 0x0E));
+            setPRGBank16K(1, outerBank + (PRGBank & 0x0E) + 1);
+            break;
+        case 2:
+            // First bank fixed at $8000, switch 16KiB at $C000
+            setPRGBank16K(0, outerBank);
+            setPRGBank16K(1, outerBank + (PRGBank & 0x0F));
+            break;
+        case 3:
+            // Switch 16KiB at $8000, last bank fixed at $C000
+            setPRGBank16K(0, outerBank + (PRGBank & 0x0F));
+            setPRGBank16K(1, outerBank + 0x0F);
+            break;
+    }
+
+    if (control & 0x10) {
+        // Two separate 4KiB CHR banks
+        setCHRBank4K(0, CHRBank0);
+        setCHRBank4K(1, CHRBank1);
+    } else {
+        // One 8KiB CHR bank, ignoring the low bit of the bank number
+        setCHRBank4K(0, CHRBank0 & 0x1E);
+        setCHRBank4K(1, (CHRBank0 & 0x1E) + 1);
+    }
+}
+
+// UxROM: Switchable 16KiB PRG-ROM bank at $8000, last bank fixed at $C000
+UxROM::UxROM(Cartridge &mCartridge) : Mapper(mCartridge) {
+
+}
+
+void UxROM::reset() {
+    setPRGBank16K(0, 0);
+    setPRGBank16K(1, -1);
+    setCHRBank8K(0);
+}
+
+void UxROM::writeRegister(unsigned short /*location*/, unsigned char value) {
+    setPRGBank16K(0, value);
+}
+
+// CNROM: Fixed PRG-ROM, switchable 8KiB CHR-ROM bank
+CNROM::CNROM(Cartridge &mCartridge) : Mapper(mCartridge) {
+
+}
+
+void CNROM::writeRegister(unsigned short /*location*/, unsigned char value) {
+    setCHRBank8K(value);
+}
+
+// MMC3: Two switchable 8KiB PRG-ROM banks, 2KiB and 1KiB CHR banks and a scanline counter that can fire IRQs
+MMC3::MMC3(Cartridge &mCartridge) : Mapper(mCartridge) {
+    bankSelect = 0;
+
+    for (unsigned char &i : bankRegisters) {
+        i = 0;
+    }
+
+    IRQLatch = 0;
+    IRQCounter = 0;
+    IRQReload = false;
+    IRQEnabled = false;
+}
+
+void MMC3::reset() {
+    bankSelect = 0;
+
+    // Give the CHR registers distinct banks until the game sets them up
+    bankRegisters[0] = 0;
+    bankRegisters[1] = 2;
+    bankRegisters[2] = 4;
+    bankRegisters[3] = 5;
+    bankRegisters[4] = 6;
+    bankRegisters[5] = 7;
+    bankRegisters[6] = 0;
+    bankRegisters[7] = 1;
+
+    IRQLatch = 0;
+    IRQCounter = 0;
+    IRQReload = false;
+    IRQEnabled = false;
+    IRQLine = false;
+    updateBanks();
+}
+
+void MMC3::writeRegister(unsigned short location, unsigned char value) {
+    // Each pair of registers is selected by the address range, and which of the pair by whether the address is even or odd
+    bool odd = location & 1;
+
+    switch (location & 0xE000) {
+        case 0x8000:
+            if (odd) {
+                bankRegisters[bankSelect & 7] = value;
+            } else {
+                bankSelect = value;
+            }
+
+            updateBanks();
+            break;
+        case 0xA000:
+            if (!odd && mirroring != NameTableMirroring::FourScreen) {
+                mirroring = (value & 1) ? NameTableMirroring::HorizontalMirroring
+                                        : NameTableMirroring::VerticalMirroring;
+            }
+
+            // Odd addresses write-protect PRG-RAM, which isn't emulated
+            break;
+        case 0xC000:
+            if (odd) {
+                // Reload the counter on the next scanline
+                IRQCounter = 0;
+                IRQReload = true;
+            } else {
+                IRQLatch = value;
+            }
+            break;
+        case 0xE000:
+            if (odd) {
+                IRQEnabled = true;
+            } else {
+                // Disabling IRQs also acknowledges any pending one
+                IRQEnabled = false;
+                IRQLine = false;
+            }
+            break;
+    }
+}
+
+void MMC3::updateBanks() {
+    // CHR: two 2KiB banks and four 1KiB banks, with bit 7 of the bank select swapping the two pattern tables
+    int CHRInvert = (bankSelect & 0x80) ? 4 : 0;
+
+    setCHRBank1K(0 ^ CHRInvert, bankRegisters[0] & 0xFE);
+    setCHRBank1K(1 ^ CHRInvert, bankRegisters[0] | 0x01);
+    setCHRBank1K(2 ^ CHRInvert, bankRegisters[1] & 0xFE);
+    setCHRBank1K(3 ^ CHRInvert, bankRegisters[1] | 0x01);
+    setCHRBank1K(4 ^ CHRInvert, bankRegisters[2]);
+    setCHRBank1K(5 ^ CHRInvert, bankRegisters[3]);
+    setCHRBank1K(6 ^ CHRInvert, bankRegisters[4]);
+    setCHRBank1K(7 ^ CHRInvert, bankRegisters[5]);
+
+    // PRG: bit 6 of the bank select swaps $8000 with the fixed second to last bank at $C000
+    if (bankSelect & 0x40) {
+        setPRGBank8K(0, -2);
+        setPRGBank8K(2, bankRegisters[6]);
+    } else {
+        setPRGBank8K(0, bankRegisters[6]);
+        setPRGBank8K(2, -2);
+    }
+
+    setPRGBank8K(1, bankRegisters[7]);
+    setPRGBank8K(3, -1);
+}
+
+void MMC3::clockScanline() {
+    if (IRQCounter == 0 || IRQReload) {
+        IRQCounter = IRQLatch;
+        IRQReload = false;
+    } else {
+        IRQCounter--;
+    }
+
+    if (IRQCounter == 0 && IRQEnabled) {
+        IRQLine = true;
+    }
+}
+
+int MMC3::scanlinesUntilIRQ() {
+    if (!IRQEnabled)
+        return -1;
+
+    // A reload takes one scanline, and then it counts down from the latch value
+    if (IRQCounter == 0 || IRQReload) {
+        return IRQLatch == 0 ? 1 : IRQLatch + 1;
+    }
+
+    return IRQCounter;
+}
+
+void MMC3::saveState(StateWriter &state) {
+    Mapper::saveState(state);
+    state.write(bankSelect);
+    state.write(bankRegisters);
+    state.write(IRQLatch);
+    state.write(IRQCounter);
+    state.write(IRQReload);
+    state.write(IRQEnabled);
+}
+
+void MMC3::loadState(StateReader &state) {
+    Mapper::loadState(state);
+    state.read(bankSelect);
+    state.read(bankRegisters);
+    state.read(IRQLatch);
+    state.read(IRQCounter);
+    state.read(IRQReload);
+    state.read(IRQEnabled);
+}
+
+// AxROM: Switchable 32KiB PRG-ROM bank, with single screen mirroring selected by the same register
+AxROM::AxROM(Cartridge &mCartridge) : Mapper(mCartridge) {
+
+}
+
+void AxROM::reset() {
+    setPRGBank32K(0);
+    setCHRBank8K(0);
+    mirroring = NameTableMirroring::SingleScreenLower;
+}
+
+void AxROM::writeRegister(unsigned short /*location*/, unsigned char value) {
+    setPRGBank32K(value & 0x07);
+    mirroring = (value & 0x10) ? NameTableMirroring::SingleScreenUpper : NameTableMirroring::SingleScreenLower;
+}
+
+// Mapper registry, indexed by the iNES mapper number
+struct MapperType {
+    int number;
+    const char *name;
+
+    Mapper *(*create)(Cartridge &cartridge);
+};
+
+template<class T>
+static Mapper *newMapper(Cartridge &cartridge) {
+    return new T(cartridge);
+}
+
+static const MapperType mapperTypes[] = {
+        {0, "NROM",  newMapper<NROM>},
+        {1, "MMC1",  newMapper<MMC1>},
+        {2, "UxROM", newMapper<UxROM>},
+        {3, "CNROM", newMapper<CNROM>},
+        {4, "MMC3",  newMapper<MMC3>},
+        {7, "AxROM", newMapper<AxROM>},
+};
+
+Mapper *createMapper(Cartridge &cartridge, std::ostream &log) {
+    for (const MapperType &type : mapperTypes) {
+        if (type.number == cartridge.mapper) {
+            log << "Mapper: " << type.name << std::endl;
+
+            Mapper *mapper = type.create(cartridge);
+            mapper->reset();
+            return mapper;
+        }
+    }
+
+    return nullptr;
 }
@@ -0,0 +1,85 @@
+#include <fstream>
+#include <iterator>
+#include "Movie.h"
+
+static const unsigned int MovieVersion = 2; // 2: frames end at VBLANK instead of after a fixed number of clocks
+
+static void writeValue(std::ofstream &file, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        file.put((char) ((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static unsigned long long readValue(const std::vector<unsigned char> &data, size_t position, int bytes) {
+    unsigned long long value = 0;
+
+    for (int i = 0; i < bytes; i++) {
+        value |= (unsigned long long) data[position + i] << (i * 8);
+    }
+
+    return value;
+}
+
+Movie::Movie() {
+    ROMHash = 0;
+}
+
+void Movie::clear(unsigned long long mROMHash) {
+    frames.clear();
+    ROMHash = mROMHash;
+}
+
+void Movie::addFrame(unsigned char buttons) {
+    frames.push_back(buttons);
+}
+
+unsigned char Movie::getFrame(size_t frame) {
+    return frame < frames.size() ? frames[frame] : 0;
+}
+
+size_t Movie::getFrameCount() {
+    return frames.size();
+}
+
+unsigned long long Movie::getROMHash() {
+    return ROMHash;
+}
+
+bool Movie::save(const std::string &fileName) {
+    std::ofstream file(fileName, std::ios::binary);
+
+    if (!file)
+        return false;
+
+    file.write("NMOV", 4);
+    writeValue(file, MovieVersion, 4);
+    writeValue(file, ROMHash, 8);
+    writeValue(file, frames.size(), 4);
+    file.write((const char *) frames.data(), frames.size());
+
+    return file.good();
+}
+
+bool Movie::load(const std::string &fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+
+    if (!file)
+        return false;
+
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const size_t HeaderSize = 20;
+
+    if (data.size() < HeaderSize || data[0] != 'N' || data[1] != 'M' || data[2] != 'O' || data[3] != 'V' ||
+        readValue(data, 4, 4) != MovieVersion) {
+        return false;
+    }
+
+    size_t frameCount = readValue(data, 16, 4);
+
+    if (data.size() - HeaderSize < frameCount)
+        return false;
+
+    ROMHash = readValue(data, 8, 8);
+    frames.assign(data.begin() + HeaderSize, data.begin() + HeaderSize + frameCount);
+    return true;
+}
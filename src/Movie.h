@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*
+ * A recording of the controller state for every frame from power on. Played back into the same ROM it always gives the
+ * same result, so it can be used to repeat a run exactly.
+ *
+ * File format (little endian):
+ *   "NMOV"              4 bytes
+ *   version             4 bytes
+ *   ROM hash            8 bytes, MainSystem::getROMHash() of the ROM it was recorded on
+ *   frame count         4 bytes
+ *   controller states   1 byte per frame, packed as in Input::Controller (bit 0 = A ... bit 7 = Right)
+ */
+class Movie {
+public:
+    Movie();
+
+    void clear(unsigned long long mROMHash); // Start a new, empty recording for the given ROM
+
+    void addFrame(unsigned char buttons);
+
+    unsigned char getFrame(size_t frame);
+
+    size_t getFrameCount();
+
+    unsigned long long getROMHash();
+
+    bool save(const std::string &fileName);
+
+    bool load(const std::string &fileName); // Returns false if the file can't be read or isn't a movie
+
+private:
+    std::vector<unsigned char> frames;
+    unsigned long long ROMHash;
+};
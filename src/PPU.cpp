@@ -1,27 +1,94 @@
-#include <SFML/Window.hpp>
-#include <SFML/Graphics.hpp>
 #include "Cartridge.h"
+#include "Mapper.h"
 #include "PPU.h"
 #include <iostream>
+#include <algorithm>
+#include <climits>
+#include <cstring>
 
 #define PPULogging55
 #define PPULOGNEWLINE55
 #define DATABUSLOGGING66
 
+// Convert the frame to RGBA with AVX2 gathers on x86 CPUs that support it, otherwise a byte at a time through the
+// palette table. Define PPU_SCALAR_DRAW to always use the table.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(PPU_SCALAR_DRAW)
+#define PPU_AVX2_DRAW
+#include <immintrin.h>
+#endif
+
 PPU::PPU() {
-    pixels = new sf::Uint8[256 * 240 * 4];
+    pixels = new unsigned char[256 * 240 * 4];
     NESPixels = new unsigned char[256 * 262]; // The NES PPU's internal render memory
-    displayImage = new sf::Image();
-    displayTexture = new sf::Texture;
-    displaySprite = new sf::Sprite;
-    displayTexture->create(256, 240);
-    displaySprite->setTexture(*displayTexture);
-    displaySprite->setScale(3, 3);
-    nameTableMirrorMode = 0;
+    mapper = nullptr;
+    profiler = nullptr;
+    setMirroring(NameTableMirroring::HorizontalMirroring);
+
+    // CHR starts out unbanked
+    for (int i = 0; i < 8; i++) {
+        CHRBanks[i] = i * 0x400;
+    }
+
+    for (unsigned char &i : registers) {
+        i = 0;
+    }
+
+    // Everything else the CPU can see starts out cleared too, so every instance of the PPU powers on the same way
+    for (unsigned char &i : PaletteMemory) {
+        i = 0;
+    }
+
+    dataAddresses[0] = dataAddresses[1] = 0;
+    db = idb = 0;
+    tileBitmapXOffset = finey = 0;
+    tileCounter = pixelOffset = bitmapLine = currentAttribute = 0;
+    bitmapLo = bitmapHi = 0;
+    currentTileRow = 0;
+    currentPalette.Colours[0] = currentPalette.Colours[1] = currentPalette.Colours[2] = 0;
+    spritesOnThisScanline = 0;
+    SpriteZeroOnThisScanline = false;
+
+    for (bool &i : spriteExists) {
+        i = false;
+    }
+
     reset();
     NMIFired = false;
     OldAttribute = 0;
     OAMAddress = 0;
+    lastSyncCycle = 0;
+    frameNumber = 0;
+    renderer = ScanlineRenderer;
+
+    // Spread the bits of every byte out to every other bit, for interleaving a tile's two bitplanes
+    for (int i = 0; i < 256; i++) {
+        bitplaneSpread[i] = 0;
+
+        for (int bit = 0; bit < 8; bit++) {
+            bitplaneSpread[i] |= ((i >> bit) & 1) << (bit * 2);
+        }
+    }
+
+    // Build the RGBA palette. There's a copy of it for each combination of the colour emphasis bits, which darken the
+    // colour channels that aren't being emphasised.
+    for (int emphasis = 0; emphasis < 8; emphasis++) {
+        for (int i = 0; i < 64; i++) {
+            Colour colour = getColour(i);
+            unsigned char rgba[4] = {colour.r, colour.g, colour.b, 255};
+
+            if (emphasis != 0) {
+                for (int channel = 0; channel < 3; channel++) {
+                    if (!getBit(channel, emphasis))
+                        rgba[channel] = (unsigned char) (rgba[channel] * 3 / 4);
+                }
+            }
+
+            std::memcpy(&RGBAPalette[(emphasis << 6) | i], rgba, 4);
+        }
+    }
+
+    // Start with blank CHR-RAM, and a tile cache to match it
+    loadCHR(nullptr, 0);
 
     // Clear the temporary OAM
     for (int i = 0; i < 0x20; i++) {
@@ -71,15 +138,15 @@ void PPU::reset() {
     YScroll = 0;
 
 
-    // Initialize the buffers (Set real SFML draw area to grey for now)
-    for (int i = 0; i <= ((256 * 240) * 4); i += 4) {
+    // Initialize the buffers (Set the RGBA output to grey for now)
+    for (int i = 0; i < ((256 * 240) * 4); i += 4) {
         pixels[i] = 128; // R
         pixels[i + 1] = 128; // G
         pixels[i + 2] = 128; // B
         pixels[i + 3] = 255; // A
     }
 
-    for (int i = 0; i <= (256 * 262); i++) {
+    for (int i = 0; i < (256 * 262); i++) {
         NESPixels[i] = 0x0;
     }
 
@@ -93,106 +160,294 @@ void PPU::reset() {
 }
 
 void PPU::execute(int PPUClock) {
+    // Run the PPU for the given number of clocks. Rather than stepping one dot at a time, each pass of this loop runs
+    // straight to the next point where something happens: the start of a scanline, the end of its visible pixels or the
+    // end of the scanline itself.
+    while (PPUClock > 0) {
+        if (currentCycle == 0) {
+            // Idle cycle at the start of the pre-render scanline
+            tileBitmapXOffset = 7;
+#ifdef NESTALGIA_PROFILER
+            profiler->countPPUDots(currentScanline, 0, 1);
+#endif
+            currentCycle++;
+            PPUClock--;
+            continue;
+        }
 
-    PPUClocks = 0;
+        if (currentCycle == 341) {
+            // Handle switching to the next scanline here
+            currentScanline++;
 
-    while (PPUClocks < PPUClock) {
-        // Perform one PPU cycle (Render one pixel - we don't need to replicate cycle by cycle memory accesses, just make sure it renders 1 pixel per cycle and timing will be fine.)
+            // If we're on the last scanline, reset the counters to 0 for the next frame. This doesn't take a clock.
+            if (currentScanline >= 260) {
+                currentScanline = -1;
+                currentCycle = 0;
+                pixelOffset = 0;
+                continue;
+            }
 
-        // Every new scanline, we should fetch the appropriate data from the nametable for this scanline.
-        // RenderNametable() function will handle the rest
+#ifdef NESTALGIA_PROFILER
+            profiler->countPPUDots(currentScanline, 0, 1);
+#endif
+            currentCycle = 1;
+            PPUClock--;
+            continue;
+        }
 
-        // Render to the internal pixel buffer only if we're on a visible pixel (1 to 256 & scanlines 0 to 240)
-        if (currentScanline == -1 && currentCycle == 1) {
-            // reset VBLANK flag
-            registers[2] = setBit(7, 0, registers[2]);
+        if (currentCycle == 1) {
+            if (currentScanline == -1) {
+                // reset VBLANK flag
+                registers[2] = setBit(7, 0, registers[2]);
 
-            // Set the data bus for initial rendering
-            int basenametable = getBit(0, registers[0]) + getBit(1, registers[0]);
-            idb = basenametable << 10; // Register layout is yyyNNYYYYYXXXXX
-        }
+                // Set the data bus for initial rendering
+                int basenametable = getBit(0, registers[0]) + getBit(1, registers[0]);
+                idb = basenametable << 10; // Register layout is yyyNNYYYYYXXXXX
+            }
 
-        // Get the nametable byte for this tile
-        int Pixel = currentCycle - 1; // Account for the non-drawing cycle
+            // VBLANK time - Set the VBLANK flag to true and fire an NMI to the CPU (if this functionality is enabled)
+            if (currentScanline == 241) {
+                // The visible part of the frame is finished
+                frameNumber++;
 
-        if (currentCycle == 0) {
-            tileBitmapXOffset = 7; // reset tileBitmapXOffset on the idle scanline
+                // Set PPU's VBLANK flag
+                registers[2] = setBit(7, 1, registers[2]);
+
+                // Fire VBLANK NMI if NMI_Enable is true
+                if (getBit(7, registers[0])) {
+                    NMIFired = true;
+                    frame = 1; // Just so we don't get spammed by std::couts
+                }
+
+#ifdef PPULogging
+                std::cout<<"VBLANK_BEGIN"<<std::endl;
+                std::cout<<(int)registers[2]<<std::endl;
+#endif
+            }
         }
 
-        if (currentCycle >= 1 && currentCycle <= 256 && currentScanline <= 240 && currentScanline >= 0) {
+        // Run up to the end of the scanline, or as far as we have clocks for
+        int runEnd = std::min(341, currentCycle + PPUClock);
+
+        // Mappers with scanline counters are clocked once per scanline while rendering, at cycle 260
+        if (mapper && currentScanline <= 239 && currentCycle <= 260 && runEnd > 260 && isRendering()) {
+            mapper->clockScanline();
+        }
 
-            // At the start of each tile on this scanline, fetch its bitmap data
-            if (tileBitmapXOffset == 7) {
-                setDataBus(currentScanline, Pixel);
-                getBitmapDataFromNameTable(idb);
-                idb++; // Increment the data bus to fetch the next tile
+        // Render to the internal pixel buffer only if we're on a visible pixel (1 to 256 & scanlines 0 to 240)
+        if (currentScanline >= 0 && currentScanline <= 240 && currentCycle <= 256) {
+#ifdef NESTALGIA_PROFILER
+            ProfileScope scope(profiler, ProfilePPURender);
+#endif
+            if (renderer == ScanlineRenderer) {
+                renderScanline(currentCycle, std::min(runEnd, 257));
+            } else {
+                renderDots(currentCycle, std::min(runEnd, 257));
             }
+        }
 
-            // Get what the value of the current pixel should be from the current tile's bitmap data
-            bool lo = getBit(tileBitmapXOffset, bitmapLo);
-            bool hi = getBit(tileBitmapXOffset, bitmapHi);
+#ifdef NESTALGIA_PROFILER
+        profiler->countPPUDots(currentScanline, currentCycle, runEnd);
+#endif
+        PPUClock -= runEnd - currentCycle;
+        currentCycle = runEnd;
+    }
+}
 
-            tileBitmapXOffset--;
-            tileBitmapXOffset &= 7; // 3-bit register, bit 4 should always be 0.
+void PPU::renderDots(int firstCycle, int endCycle) {
+    // Render the visible pixels for cycles firstCycle up to (but not including) endCycle on the current scanline
+    for (int cycle = firstCycle; cycle < endCycle; cycle++) {
+        int Pixel = cycle - 1; // Account for the non-drawing cycle
 
-            // Read an attribute byte for it to display
-            currentAttribute = readAttribute(Pixel, currentScanline,
-                                             0); // For now just read from the first attribute table to make sure things are working
+        // At the start of each tile on this scanline, fetch its bitmap data
+        if (tileBitmapXOffset == 7) {
+            setDataBus(currentScanline, Pixel);
+            getBitmapDataFromNameTable(idb);
+            idb++; // Increment the data bus to fetch the next tile
+        }
 
-            readColour(currentAttribute);
-            drawBitmapPixel(lo, hi, Pixel, currentScanline);
+        // Get what the value of the current pixel should be from the current tile's bitmap data
+        bool lo = getBit(tileBitmapXOffset, bitmapLo);
+        bool hi = getBit(tileBitmapXOffset, bitmapHi);
 
-            pixelOffset++; // The pixel offset of the current tile
+        tileBitmapXOffset--;
+        tileBitmapXOffset &= 7; // 3-bit register, bit 4 should always be 0.
 
-            // reset the pixel counter if it goes above 7 as we'll need to fetch the next tile soon
-            if (pixelOffset > 7)
-                pixelOffset = 0;
+        // Read an attribute byte for it to display
+        currentAttribute = readAttribute(Pixel, currentScanline,
+                                         0); // For now just read from the first attribute table to make sure things are working
+
+        readColour(currentAttribute);
+        drawBitmapPixel(lo, hi, Pixel, currentScanline);
 
-            // Render the sprites for this scanline
-            renderSprites(currentScanline, Pixel);
+        pixelOffset++; // The pixel offset of the current tile
 
-            // Evaluate sprites for the next scanline at cycle 256
-            if (currentCycle == 256)
-                evaluateSprites(currentScanline + 1);
+        // reset the pixel counter if it goes above 7 as we'll need to fetch the next tile soon
+        if (pixelOffset > 7)
+            pixelOffset = 0;
+
+        // Render the sprites for this scanline
+        renderSprites(currentScanline, Pixel);
+
+        // Evaluate sprites for the next scanline at cycle 256
+        if (cycle == 256)
+            evaluateSprites(currentScanline + 1);
+    }
+}
+
+void PPU::renderScanline(int firstCycle, int endCycle) {
+    // Does the same job as renderDots(), but a tile at a time instead of a pixel at a time. The span is normally a whole
+    // scanline, it is only shorter when the CPU touches the PPU part way through one.
+    unsigned char *row = NESPixels + (currentScanline * 256);
+    int pixel = firstCycle - 1;
+    int endPixel = endCycle - 1;
+    unsigned char colours[4];
+
+    colours[0] = readPalette(0x3F00); // Background colour
+
+    while (pixel < endPixel) {
+        // At the start of each tile on this scanline, fetch its already decoded bitmap data
+        if ((pixel & 7) == 0) {
+            setDataBus(currentScanline, pixel);
+            currentTileRow = tileRows[getTileRow(getCHRAddress(getBackgroundPatternAddress(idb)))];
+            idb++;
         }
 
-        // Handle switching to the next scanline here
-        if (currentCycle == 341) {
-            currentCycle = 0;
-            currentScanline++;
+        // All 8 pixels of a tile share an attribute, so only look it up once
+        currentAttribute = readAttribute(pixel, currentScanline, 0);
+        readColour(currentAttribute);
+        colours[1] = currentPalette.Colours[0];
+        colours[2] = currentPalette.Colours[1];
+        colours[3] = currentPalette.Colours[2];
+
+        int tileEnd = std::min((pixel | 7) + 1, endPixel);
+
+        for (; pixel < tileEnd; pixel++) {
+            row[pixel] = colours[(currentTileRow >> (14 - ((pixel & 7) * 2))) & 3];
         }
+    }
 
-        // VBLANK time - Set the VBLANK flag to true and fire an NMI to the CPU (if this functionality is enabled)
-        if (currentScanline == 241 && currentCycle == 1) {
-            // Fire VBLANK NMI if NMI_Enable is true
-            // Set PPU's VBLANK flag
-            registers[2] = setBit(7, 1, registers[2]);
+    // Leave the tile counters where the dot renderer would have left them
+    tileBitmapXOffset = 7 - (endPixel & 7);
+    pixelOffset = endPixel & 7;
 
-            if (getBit(7, registers[0])) {
-                NMIFired = true;
-                frame = 1; // Just so we don't get spammed by std::couts
-            }
+    // Draw the sprites over the background, lowest priority first so that sprite 0 ends up on top
+    for (int count = 7; count >= 0; count--) {
+        if (!spriteExists[count])
+            continue;
 
+        SpriteUnit *sprite = spriteUnits[count];
+        int spriteEnd = std::min(sprite->XPos + 8, endPixel);
 
-#ifdef PPULogging
-            std::cout<<"VBLANK_BEGIN"<<std::endl;
-            std::cout<<(int)registers[2]<<std::endl;
-#endif
-        }
+        for (pixel = std::max((int) sprite->XPos, firstCycle - 1); pixel < spriteEnd; pixel++) {
+            int pixelValue = sprite->bitmap >> 14;
 
-        // If we're on the last scanline, reset the counters to 0 for the next frame.
-        if (currentScanline >= 260) {
-            currentScanline = -1;
-            currentCycle = 0;
-            pixelOffset = 0;
-        } else {
-            PPUClocks++;
-            currentCycle++;
+            if (pixelValue != 0)
+                row[pixel] = sprite->palette.Colours[pixelValue - 1];
+
+            // Shift the bitmap to the next pixel
+            sprite->bitmap <<= 2;
         }
+    }
+
+    // Evaluate sprites for the next scanline at cycle 256
+    if (endCycle > 256)
+        evaluateSprites(currentScanline + 1);
+}
+
+void PPU::catchUp(unsigned long long CPUCycle) {
+    // Bring the PPU up to date with the CPU. Nothing is run until something needs to see the PPU's state.
+    if (CPUCycle > lastSyncCycle) {
+#ifdef NESTALGIA_PROFILER
+        ProfileScope scope(profiler, ProfilePPU);
+#endif
+        execute((int) (CPUCycle - lastSyncCycle) * 3); // PPU's clock is 3x the CPU's
+        lastSyncCycle = CPUCycle;
+    }
+}
+
+int PPU::cyclesUntilVBlank() {
+    // execute() steps through one position per PPU clock, from scanline -1 dot 0 up to scanline 259 dot 340, so the
+    // distance to the VBLANK check at scanline 241 dot 1 can be worked out directly from the current position.
+    const int VBlankPosition = (241 + 1) * 341 + 1;
+    int dots = (VBlankPosition - getFramePosition() + dotsPerFrame) % dotsPerFrame;
+
+    // The VBLANK dot itself has to be executed too, and the PPU runs 3 clocks per CPU cycle
+    return (dots + 1 + 2) / 3;
+}
+
+int PPU::cyclesUntilScanlineClock(int scanlines) {
+    // The number of CPU cycles to run before the mapper's scanline counter has been clocked the given number of times.
+    // It is clocked at cycle 260 of scanlines -1 to 239, but only while rendering is enabled.
+    if (scanlines <= 0 || !isRendering())
+        return INT_MAX;
+
+    const int clocksPerFrame = 241;
+    const int lastClockPosition = (239 + 1) * 341 + 260;
+    int position = getFramePosition();
+    int frames = 0;
+    int line = 0; // Counts from scanline -1
+
+    if (position > lastClockPosition) {
+        // No more this frame, start counting from the next one
+        frames = 1;
+    } else if (position > 260) {
+        line = (position - 260 + 340) / 341;
+    }
+
+    line += scanlines - 1;
+    frames += line / clocksPerFrame;
+    line %= clocksPerFrame;
+
+    int dots = (frames * dotsPerFrame) + (line * 341) + 260 - position;
+    return (dots + 1 + 2) / 3;
+}
+
+int PPU::getFramePosition() {
+    // The number of PPU clocks since the start of the frame (scanline -1, dot 0)
+    return (currentScanline + 1) * 341 + currentCycle;
+}
+
+bool PPU::isRendering() {
+    // Rendering is on if either the background or sprites are enabled in PPUMASK
+    return (registers[1] & 0x18) != 0;
+}
+
+void PPU::setMirroring(int mirroring) {
+    // Point each of the 4 nametables the CPU can see at the nametable memory that backs it
+    int layout[4];
 
+    switch (mirroring) {
+        case NameTableMirroring::HorizontalMirroring:
+        default:
+            layout[0] = 0; layout[1] = 0; layout[2] = 1; layout[3] = 1;
+            break;
+        case NameTableMirroring::VerticalMirroring:
+            layout[0] = 0; layout[1] = 1; layout[2] = 0; layout[3] = 1;
+            break;
+        case NameTableMirroring::SingleScreenLower:
+            layout[0] = 0; layout[1] = 0; layout[2] = 0; layout[3] = 0;
+            break;
+        case NameTableMirroring::SingleScreenUpper:
+            layout[0] = 1; layout[1] = 1; layout[2] = 1; layout[3] = 1;
+            break;
+        case NameTableMirroring::FourScreen:
+            layout[0] = 0; layout[1] = 1; layout[2] = 2; layout[3] = 3;
+            break;
     }
 
-    PPUClocks = 0;
+    nameTableMirrorMode = mirroring;
+
+    for (int i = 0; i < 4; i++) {
+        nameTableMap[i] = Nametables[layout[i]].data;
+    }
+}
+
+void PPU::setCHRBanks(const int *banks) {
+    // Set the offsets into CHR memory of each 1KiB bank of the pattern tables
+    for (int i = 0; i < 8; i++) {
+        CHRBanks[i] = banks[i];
+    }
 }
 
 void PPU::renderSprites(int scanLine, int pixel) {
@@ -204,15 +459,14 @@ void PPU::renderSprites(int scanLine, int pixel) {
         if (spriteExists[count]) {
             // The sprite exists on this scanline if this check passed
             if (pixel >= spriteUnits[count]->XPos && pixel < spriteUnits[count]->XPos + 8) {
-                // Render the bit of the the sprite's bitmap data for this pixel
-                bool bitlo = getBit(7, spriteUnits[count]->bitmapLo);
-                bool bithi = getBit(7, spriteUnits[count]->bitmapHi);
+                // Render the bits of the the sprite's bitmap data for this pixel
+                bool bitlo = (spriteUnits[count]->bitmap >> 14) & 1;
+                bool bithi = (spriteUnits[count]->bitmap >> 15) & 1;
 
                 drawBitmapPixel(bitlo, bithi, pixel, scanLine, count);
 
-                // Bit-shift the bitmap to the next pixel
-                spriteUnits[count]->bitmapHi <<= 1;
-                spriteUnits[count]->bitmapLo <<= 1;
+                // Shift the bitmap to the next pixel
+                spriteUnits[count]->bitmap <<= 2;
             }
         }
         count--;
@@ -257,27 +511,68 @@ void PPU::drawPixel(unsigned char value, int scanLine, int pixel) {
               pixel] = value; // scanLine 0 is an idle scanline, so -1 so we don't overflow the pixel space here (so that pixel 256 actually appears on the right hand side)
 }
 
-void PPU::draw(sf::RenderWindow &window) {
-    // Draws everything in the PPU's bitmap buffer to the window. should be called once per frame.
+#ifdef PPU_AVX2_DRAW
+__attribute__((target("avx2")))
+static void convertPixelsAVX2(const unsigned char *NESPixels, unsigned int *output, const unsigned int *palette,
+                              int count) {
+    // Look up 8 pixels at a time. count has to be a multiple of 8.
+    const __m256i colourMask = _mm256_set1_epi32(0x3F);
+
+    for (int i = 0; i < count; i += 8) {
+        __m128i indices = _mm_loadl_epi64((const __m128i *) (NESPixels + i));
+        __m256i colours = _mm256_and_si256(_mm256_cvtepu8_epi32(indices), colourMask);
+        __m256i rgba = _mm256_i32gather_epi32((const int *) palette, colours, 4);
+        _mm256_storeu_si256((__m256i *) (output + i), rgba);
+    }
+}
+#endif
+
+void PPU::draw() {
+    // Converts everything in the PPU's bitmap buffer to RGBA in the pixels buffer. should be called once per frame.
     // Could potentially be called in the PPU::execute function on the last clock of a frame.
 
-    // Cycle through the NES's video output and convert it into a form for SFML to display
-    int PixelInc = 0;
-    for (int i = 0; i <= (256 * 239); i++) {
-        // Get the colour of the current pixel
-        sf::Color CurrentColour = getColour(NESPixels[i]);
+    // Colour emphasis is taken from PPUMASK as it is now and applied to the whole frame
+    const unsigned int *palette = &RGBAPalette[(registers[1] >> 5) << 6];
+    unsigned int *output = (unsigned int *) pixels;
+    const int pixelCount = 256 * 240;
+
+#ifdef PPU_AVX2_DRAW
+    if (__builtin_cpu_supports("avx2")) {
+        convertPixelsAVX2(NESPixels, output, palette, pixelCount);
+        return;
+    }
+#endif
 
-        pixels[PixelInc] = CurrentColour.r;
-        pixels[PixelInc + 1] = CurrentColour.g;
-        pixels[PixelInc + 2] = CurrentColour.b;
-        pixels[PixelInc + 3] = 255;
-        PixelInc += 4;
+    for (int i = 0; i < pixelCount; i++) {
+        output[i] = palette[NESPixels[i] & 0x3F];
     }
+}
+
+const unsigned char *PPU::getNESPixels() {
+    return NESPixels;
+}
+
+unsigned long long PPU::getFrameNumber() {
+    return frameNumber;
+}
+
+int PPU::getDotsPerFrame() {
+    return dotsPerFrame;
+}
 
-    displayTexture->update(pixels);
-    if (window.isOpen()) {
-        window.draw(*displaySprite);
+unsigned long long PPU::getFrameHash() {
+    // A quick hash of everything that goes into draw()'s output - the frame's pixels and the colour emphasis bits. Reads
+    // the pixels 8 at a time, so it costs a small fraction of a call to draw().
+    unsigned long long hash = 0xCBF29CE484222325ULL ^ (registers[1] >> 5);
+
+    for (int i = 0; i < 256 * 240; i += 8) {
+        unsigned long long block;
+        std::memcpy(&block, NESPixels + i, 8);
+        hash = (hash ^ block) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
     }
+
+    return hash;
 }
 
 void PPU::RenderNametable(int Nametable, int OffsetX, int OffsetY) {
@@ -310,30 +605,34 @@ void PPU::writeMemory(unsigned short location, unsigned char value) {
 #endif
 
     // Direct the data to the appropriate part of the PPU's memory...
-    if (CHRRAM && location <= 0x1FFF)
-        cROM[location] = value;
+    location &= 0x3FFF; // The PPU's address space is 14 bits
 
-    if (location >= 0x2000 && location <= 0x2FFF)
+    if (CHRRAM && location <= 0x1FFF) {
+        unsigned int CHRLocation = getCHRAddress(location);
+        CHRRAMData[CHRLocation] = value;
+        decodeTileRow(CHRLocation);
+    }
+
+    // $3000-$3EFF mirrors the nametables
+    if (location >= 0x2000 && location <= 0x3EFF)
         writeNameTable(location, value); // Write to the appropriate nametable
 
-    if (location >= 0x3F00 && location <= 0x3F1F)
+    if (location >= 0x3F00)
         writePalette(location, value);
 }
 
 unsigned char PPU::readMemory(unsigned short location) {
+    location &= 0x3FFF; // The PPU's address space is 14 bits
+
     if (location <= 0x1FFF) {
-        return cROM[location];
+        return CHRMemory[getCHRAddress(location)];
     }
 
-    if (location <= 0x2FFF) {
+    if (location <= 0x3EFF) {
         return readNameTable(location);
     }
 
-    if (location <= 0x3F1F) {
-        return readPalette(location);
-    }
-
-    return 0x0; // Out of range
+    return readPalette(location);
 }
 
 unsigned char PPU::getNextByte() {
@@ -360,41 +659,204 @@ void PPU::setDataBus(int currentScanLine, int currentPixelXLocation) {
 }
 
 void PPU::getBitmapDataFromNameTable(unsigned short databus) {
+    // Should be called once per tile (so 33 times per scanline) or every 8 pixels
+    unsigned short PatternAddress = getBackgroundPatternAddress(databus);
 
+    // Fill the bitmap shift registers with the CHR data for this tile. The dot renderer decodes these itself rather than
+    // using the tile cache, so that it can be used to check the cache too.
+    bitmapLo = CHRMemory[getCHRAddress(PatternAddress)];
+    bitmapHi = CHRMemory[getCHRAddress(PatternAddress + 8)];
+}
+
+unsigned short PPU::getBackgroundPatternAddress(unsigned short databus) {
     // Ignore the top 3 bits of the data bus as this is relating to fine scroll (the MSB is not used as this is a 15-bit register)
     unsigned short TileLocation = databus << 4;
     TileLocation = TileLocation >> 4;
 
-    // Should be called once per tile (so 33 times per scanline) or every 8 pixels
     unsigned char data = readNameTable(0x2000 + TileLocation);
-    unsigned short PatternOffset = 0;
     int PatternToRead = (data) * 16;
 
-    // Fill the bitmap shift registers with the CHR data for this tile
-    bitmapLo = readPatternTable(PatternOffset + (PatternToRead + bitmapLine), 0);
-    bitmapHi = readPatternTable(PatternOffset + (8 + PatternToRead + bitmapLine), 0);
+    // Returns the location of the low bitplane byte for the current line of the tile, the high bitplane is 8 bytes after it
+    unsigned short offset = getBit(4, registers[0]) ? 0x1000 : 0x0;
+    return offset + PatternToRead + bitmapLine;
 }
 
-unsigned char PPU::readPatternTable(unsigned short Location, int PatternType) {
-    // Pattern type 0 = Background, 1 = Sprites
+unsigned int PPU::getCHRAddress(unsigned short location) {
+    // Find where a pattern table address is in CHR memory, through the mapper's 1KiB CHR banks
+    return CHRBanks[(location >> 10) & 7] + (location & 0x3FF);
+}
+
+int PPU::getTileRow(unsigned int location) {
+    // Index into the tile cache for the tile row that the given CHR byte belongs to. Each 16-byte tile has 8 rows, with the
+    // low bitplanes in the first 8 bytes and the high bitplanes in the second 8.
+    return ((location >> 4) << 3) | (location & 7);
+}
 
-    // Add more logic to this later for handling mappers
-    unsigned short offset = 0x0;
+void PPU::decodeTileRow(unsigned int location) {
+    // Rebuild the cached copy of the tile row the given CHR byte belongs to. Has to be called after any change to CHR data.
+    unsigned int lowPlane = location & ~0x8;
+    unsigned short decoded = bitplaneSpread[CHRMemory[lowPlane]] | (bitplaneSpread[CHRMemory[lowPlane + 8]] << 1);
+    unsigned short flipped = 0;
 
-    if (getBit((4 - PatternType), registers[0])) {
-        offset = 0x1000;
+    // Reverse the order of the pixels for sprites that are flipped horizontally
+    for (int i = 0; i < 8; i++) {
+        flipped |= ((decoded >> (i * 2)) & 3) << ((7 - i) * 2);
     }
-    return cROM[offset + Location];
+
+    // The first pixel is kept in the top two bits so the row can be shifted out left to right
+    tileRows[getTileRow(location)] = decoded;
+    tileRowsFlipped[getTileRow(location)] = flipped;
 }
 
-void PPU::writeCROM(unsigned short location, unsigned char value) {
-    // Will need to add more logic to these later for mappers
-    cROM[location] = value;
+void PPU::loadCHR(const unsigned char *CHRROM, int size) {
+    // CHR-ROM is read straight from the cartridge, only the tile cache needs building from it. Cartridges without CHR-ROM
+    // get a blank 8KiB of CHR-RAM. Both are sized to the cartridge, and memory for whatever isn't used is given back.
+    if (CHRROM) {
+        std::vector<unsigned char>().swap(CHRRAMData);
+        CHRMemory = CHRROM;
+    } else {
+        CHRRAMData.assign(0x2000, 0);
+        CHRMemory = CHRRAMData.data();
+        size = 0x2000;
+    }
+
+    tileRows.assign(size / 2, 0);
+    tileRowsFlipped.assign(size / 2, 0);
+    tileRows.shrink_to_fit();
+    tileRowsFlipped.shrink_to_fit();
+
+    for (int i = 0; i < size; i += 16) {
+        for (int row = 0; row < 8; row++) {
+            decodeTileRow(i + row);
+        }
+    }
 }
 
-unsigned char PPU::readCROM(unsigned short location) {
-    // Will need to add more logic to these later for mappers
-    return cROM[location];
+void PPU::saveState(StateWriter &state) {
+    // Memory
+    for (NameTable &nameTable : Nametables) {
+        state.write(nameTable.data);
+    }
+
+    state.write(PaletteMemory);
+    state.write(OAM);
+    state.write(tempOAM);
+    state.write(CHRRAMData.data(), CHRRAMData.size());
+
+    // Registers and latches
+    state.write(registers);
+    state.write(OAMAddress);
+    state.write(NMIFired);
+    state.write(dataAddresses);
+    state.write(addressSelectCounter);
+    state.write(scrollLatchCounter);
+    state.write(XScroll);
+    state.write(YScroll);
+    state.write(db);
+    state.write(idb);
+    state.write(tileBitmapXOffset);
+    state.write(finey);
+
+    // Position in the frame and the renderers' progress through it
+    state.write(lastSyncCycle);
+    state.write(currentCycle);
+    state.write(currentScanline);
+    state.write(currentTile);
+    state.write(tileCounter);
+    state.write(pixelOffset);
+    state.write(bitmapLine);
+    state.write(currentAttribute);
+    state.write(OldAttribute);
+    state.write(bitmapLo);
+    state.write(bitmapHi);
+    state.write(currentTileRow);
+    state.write(currentPalette);
+    state.write(frame);
+
+    // Sprites on the current scanline
+    state.write(spritesOnThisScanline);
+    state.write(Sprite);
+    state.write(spriteExists);
+    state.write(SpriteZeroOnThisScanline);
+
+    for (SpriteUnit *unit : spriteUnits) {
+        state.write(unit->palette);
+        state.write(unit->bitmap);
+        state.write(unit->XPos);
+        state.write(unit->YPos);
+    }
+}
+
+void PPU::loadState(StateReader &state) {
+    for (NameTable &nameTable : Nametables) {
+        state.read(nameTable.data);
+    }
+
+    state.read(PaletteMemory);
+    state.read(OAM);
+    state.read(tempOAM);
+
+    // Only re-decode the CHR-RAM tiles that are different - between states close together that's usually none of them
+    const unsigned char *CHRData = state.readBytes(CHRRAMData.size());
+
+    if (CHRData) {
+        for (unsigned int tile = 0; tile < CHRRAMData.size(); tile += 16) {
+            if (std::memcmp(&CHRRAMData[tile], CHRData + tile, 16) != 0) {
+                std::memcpy(&CHRRAMData[tile], CHRData + tile, 16);
+
+                for (int row = 0; row < 8; row++) {
+                    decodeTileRow(tile + row);
+                }
+            }
+        }
+    }
+
+    state.read(registers);
+    state.read(OAMAddress);
+    state.read(NMIFired);
+    state.read(dataAddresses);
+    state.read(addressSelectCounter);
+    state.read(scrollLatchCounter);
+    state.read(XScroll);
+    state.read(YScroll);
+    state.read(db);
+    state.read(idb);
+    state.read(tileBitmapXOffset);
+    state.read(finey);
+
+    state.read(lastSyncCycle);
+    state.read(currentCycle);
+    state.read(currentScanline);
+    state.read(currentTile);
+    state.read(tileCounter);
+    state.read(pixelOffset);
+    state.read(bitmapLine);
+    state.read(currentAttribute);
+    state.read(OldAttribute);
+    state.read(bitmapLo);
+    state.read(bitmapHi);
+    state.read(currentTileRow);
+    state.read(currentPalette);
+    state.read(frame);
+
+    state.read(spritesOnThisScanline);
+    state.read(Sprite);
+    state.read(spriteExists);
+    state.read(SpriteZeroOnThisScanline);
+
+    for (SpriteUnit *unit : spriteUnits) {
+        state.read(unit->palette);
+        state.read(unit->bitmap);
+        state.read(unit->XPos);
+        state.read(unit->YPos);
+    }
+
+    // Positions the PPU can never be at would run it past the ends of its scanline, tile and sprite arrays
+    if (currentCycle < 0 || currentCycle > 341 || currentScanline < -1 || currentScanline > 259 ||
+        tileCounter < 0 || tileCounter > 7 || pixelOffset < 0 || pixelOffset > 7 || bitmapLine < 0 || bitmapLine > 7 ||
+        tileBitmapXOffset > 7 || spritesOnThisScanline < 0 || spritesOnThisScanline > 8) {
+        state.failed = true;
+    }
 }
 
 void PPU::selectAddress(unsigned char value) {
@@ -469,69 +931,19 @@ unsigned char PPU::readRegister(unsigned short location) {
 }
 
 unsigned char PPU::readNameTable(unsigned short location) {
-
-    location -= 0x2000; // Strip off the first $2000 - we don't need it
-    int TargetNametable = 0;
-
-    if (location <= 0x3FF) {
-        TargetNametable = 0;
-    } else if (location <= 0x7FF) {
-        TargetNametable = 1;
-    } else if (location <= 0xBFF) {
-        TargetNametable = 2;
-    } else {
-        TargetNametable = 3;
-    }
-
-    unsigned short ReadLocation = location & 0x3FF;
-
-    return Nametables[TargetNametable].data[ReadLocation];
+    // $2000-$2FFF holds 4 nametables of $400 bytes, which are mapped onto the nametable memory by setMirroring()
+    location &= 0xFFF;
+    return nameTableMap[location >> 10][location & 0x3FF];
 }
 
 void PPU::writeNameTable(unsigned short location, unsigned char value) {
-    location -= 0x2000; // Strip off the first $2000 - we don't need it
-    int TargetNametable = 0;
-
-    if (location <= 0x3FF) {
-        TargetNametable = 0;
-    } else if (location <= 0x7FF) {
-        TargetNametable = 1;
-    } else if (location <= 0xBFF) {
-        TargetNametable = 2;
-    } else {
-        TargetNametable = 3;
-    }
+    location &= 0xFFF;
 
-    //unsigned short WriteLocation = location-(0x400*TargetNametable);
-    unsigned short WriteLocation = location & 0x3FF;
 #ifdef DATABUSLOGGING
-    std::cout<<std::hex<<"NAMETABLE "<<(int) TargetNametable<<" WRITE at: $"<<(int)OldLocation<<" : $"<<(int)location<< " : $"<<(int) WriteLocation<<" = $"<<(int)value<<std::endl;
+    std::cout<<std::hex<<"NAMETABLE "<<(int) (location >> 10)<<" WRITE at: $"<<(int)location<<" = $"<<(int)value<<std::endl;
 #endif
 
-    // Write the data to the NameTable
-    if (nameTableMirrorMode == 0) {
-        // Vertical mirroring
-        if (TargetNametable == 0 || TargetNametable == 1) {
-            // Nametables 0 and 1 mirror eachother in this mode (2000 & 2400)
-            Nametables[0].data[WriteLocation] = value;
-            Nametables[1].data[WriteLocation] = value;
-        } else {
-            Nametables[2].data[WriteLocation] = value;
-            Nametables[3].data[WriteLocation] = value;
-        }
-    }
-
-    // TODO: Re-read about the name table mirroring, I have two commits here which disagree on it.
-    if (nameTableMirrorMode == 1) {
-        // Horizontal mirroring
-        if (TargetNametable == 0 || TargetNametable == 2) {
-            Nametables[0].data[WriteLocation] = value;
-            Nametables[2].data[WriteLocation] = value;
-        } else {
-            Nametables[1].data[WriteLocation] = value;
-            Nametables[3].data[WriteLocation] = value;
-        }
-    }
+    nameTableMap[location >> 10][location & 0x3FF] = value;
 }
 
 void PPU::writeRegister(unsigned short registerId, unsigned char value) {
@@ -649,8 +1061,7 @@ void PPU::evaluateSprites(int currentScanLine) {
     for (int i = 0; i < 8; i++) {
         Sprite[i] = 0;
         spriteExists[i] = false;
-        spriteUnits[i]->bitmapHi = 0;
-        spriteUnits[i]->bitmapLo = 0;
+        spriteUnits[i]->bitmap = 0;
         spriteUnits[i]->palette.Colours[0] = 0;
         spriteUnits[i]->palette.Colours[1] = 0;
         spriteUnits[i]->palette.Colours[2] = 0;
@@ -697,24 +1108,13 @@ void PPU::evaluateSprites(int currentScanLine) {
                 if (getBit(7, tempOAM[(spritesOnThisScanline * 4) + 2]))
                     bitmapline = (~bitmapline) & 7;
 
-                // Fetch the bitmap data for the sprite
-                spriteUnits[spritesOnThisScanline]->bitmapLo = readPatternTable(TileID + bitmapline, 1);
-                spriteUnits[spritesOnThisScanline]->bitmapHi = readPatternTable(8 + TileID + bitmapline, 1);
+                // Fetch the decoded bitmap data for the sprite, mirrored horizontally if needed
+                int TileRow = getTileRow(getCHRAddress(TileBank + TileID + bitmapline));
 
-                // Handle horizontal mirroring
                 if (getBit(6, tempOAM[(spritesOnThisScanline * 4) + 2])) {
-
-                    unsigned char tmp1 = 0;
-                    unsigned char tmp2 = 0;
-
-                    for (int i = 0; i < 8; i++) {
-                        tmp1 |= ((spriteUnits[spritesOnThisScanline]->bitmapLo >> i) & 1) << (7 - i);
-                        tmp2 |= ((spriteUnits[spritesOnThisScanline]->bitmapHi >> i) & 1) << (7 - i);
-                    }
-
-                    spriteUnits[spritesOnThisScanline]->bitmapLo = tmp1;
-                    spriteUnits[spritesOnThisScanline]->bitmapHi = tmp2;
-
+                    spriteUnits[spritesOnThisScanline]->bitmap = tileRowsFlipped[TileRow];
+                } else {
+                    spriteUnits[spritesOnThisScanline]->bitmap = tileRows[TileRow];
                 }
 
                 // Figure out which colour palette the sprite is supposed to use, and store it.
@@ -752,13 +1152,13 @@ void PPU::readColour(int attribute, int spriteId) {
 }
 
 unsigned char PPU::readPalette(unsigned short location) {
-    location -= 0x3F00;
+    location &= 0x1F; // $3F20-$3FFF mirrors the palette
     return PaletteMemory[location];
 }
 
 void PPU::writePalette(unsigned short location, unsigned char value) {
 
-    location -= 0x3F00;
+    location &= 0x1F; // $3F20-$3FFF mirrors the palette
 
     // Handle the mirrored values
     if (location == 0x0 || location == 0x10) {
@@ -777,120 +1177,119 @@ void PPU::writePalette(unsigned short location, unsigned char value) {
     PaletteMemory[location] = value;
 }
 
-sf::Color PPU::getColour(unsigned char NESColour) {
-    // Converts a NES colour to a sf::Color to be displayed on the actual emulator's output.
-    sf::Color RetVal;
+Colour PPU::getColour(unsigned char NESColour) {
+    // Converts a NES colour to an RGB Colour to be displayed on the actual emulator's output.
 
     // Nasty hack-ish solution, and some of the colours are wrong. Be sure to fix this when implementing real colour support.
     // Just use this for now to check that the PPU is drawing the correct values to the internal bitmap
     switch (NESColour) {
         case 0x00:
-            return sf::Color(84, 84, 84, 255);
+            return {84, 84, 84};
         case 0x01:
-            return sf::Color(0, 30, 116, 255);
+            return {0, 30, 116};
         case 0x02:
-            return sf::Color(8, 16, 144, 255);
+            return {8, 16, 144};
         case 0x03:
-            return sf::Color(48, 0, 136, 255);
+            return {48, 0, 136};
         case 0x04:
-            return sf::Color(68, 0, 100, 255);
+            return {68, 0, 100};
         case 0x05:
-            return sf::Color(92, 0, 48, 255);
+            return {92, 0, 48};
         case 0x06:
-            return sf::Color(84, 4, 0, 255);
+            return {84, 4, 0};
         case 0x07:
-            return sf::Color(60, 24, 0, 255);
+            return {60, 24, 0};
         case 0x08:
-            return sf::Color(32, 42, 0, 255);
+            return {32, 42, 0};
         case 0x09:
-            return sf::Color(8, 58, 0, 255);
+            return {8, 58, 0};
         case 0x0A:
-            return sf::Color(0, 64, 0, 255);
+            return {0, 64, 0};
         case 0x0B:
-            return sf::Color(0, 60, 0, 255);
+            return {0, 60, 0};
         case 0x0C:
-            return sf::Color(0, 50, 60, 255);
+            return {0, 50, 60};
         case 0x10:
-            return sf::Color(152, 150, 152, 255);
+            return {152, 150, 152};
         case 0x11:
-            return sf::Color(8, 76, 196, 255);
+            return {8, 76, 196};
         case 0x12:
-            return sf::Color(48, 50, 236, 255);
+            return {48, 50, 236};
         case 0x13:
-            return sf::Color(92, 30, 228, 255);
+            return {92, 30, 228};
         case 0x14:
-            return sf::Color(136, 20, 176, 255);
+            return {136, 20, 176};
         case 0x15:
-            return sf::Color(160, 20, 100, 255);
+            return {160, 20, 100};
         case 0x16:
-            return sf::Color(152, 34, 32, 255);
+            return {152, 34, 32};
         case 0x17:
-            return sf::Color(120, 60, 0, 255);
+            return {120, 60, 0};
         case 0x18:
-            return sf::Color(84, 90, 0, 255);
+            return {84, 90, 0};
         case 0x19:
-            return sf::Color(40, 114, 0, 255);
+            return {40, 114, 0};
         case 0x1A:
-            return sf::Color(8, 124, 0, 255);
+            return {8, 124, 0};
         case 0x1B:
-            return sf::Color(0, 118, 40, 255);
+            return {0, 118, 40};
         case 0x1C:
-            return sf::Color(0, 102, 120, 255);
+            return {0, 102, 120};
         case 0x20:
-            return sf::Color(236, 238, 236, 255);
+            return {236, 238, 236};
         case 0x21:
-            return sf::Color(76, 154, 236, 255);
+            return {76, 154, 236};
         case 0x22:
-            return sf::Color(120, 124, 236, 255);
+            return {120, 124, 236};
         case 0x23:
-            return sf::Color(176, 98, 236, 255);
+            return {176, 98, 236};
         case 0x24:
-            return sf::Color(228, 84, 236, 255);
+            return {228, 84, 236};
         case 0x25:
-            return sf::Color(236, 88, 180, 255);
+            return {236, 88, 180};
         case 0x26:
-            return sf::Color(236, 106, 100, 255);
+            return {236, 106, 100};
         case 0x27:
-            return sf::Color(212, 136, 32, 255);
+            return {212, 136, 32};
         case 0x28:
-            return sf::Color(160, 170, 0, 255);
+            return {160, 170, 0};
         case 0x29:
-            return sf::Color(116, 196, 0, 255);
+            return {116, 196, 0};
         case 0x2A:
-            return sf::Color(76, 208, 32, 255);
+            return {76, 208, 32};
         case 0x2B:
-            return sf::Color(56, 204, 108, 255);
+            return {56, 204, 108};
         case 0x2C:
-            return sf::Color(56, 180, 204, 255);
+            return {56, 180, 204};
         case 0x2D:
-            return sf::Color(236, 238, 236, 255);
+            return {236, 238, 236};
         case 0x30:
-            return sf::Color(168, 204, 236, 255);
+            return {168, 204, 236};
         case 0x31:
-            return sf::Color(118, 118, 236, 255);
+            return {118, 118, 236};
         case 0x32:
-            return sf::Color(212, 178, 236, 255);
+            return {212, 178, 236};
         case 0x33:
-            return sf::Color(236, 174, 236, 255);
+            return {236, 174, 236};
         case 0x34:
-            return sf::Color(236, 164, 212, 255);
+            return {236, 164, 212};
         case 0x35:
-            return sf::Color(236, 180, 176, 255);
+            return {236, 180, 176};
         case 0x36:
-            return sf::Color(228, 196, 144, 255);
+            return {228, 196, 144};
         case 0x37:
-            return sf::Color(204, 210, 120, 255);
+            return {204, 210, 120};
         case 0x38:
-            return sf::Color(180, 222, 120, 255);
+            return {180, 222, 120};
         case 0x39:
-            return sf::Color(168, 226, 144, 255);
+            return {168, 226, 144};
         case 0x3A:
-            return sf::Color(152, 226, 180, 255);
+            return {152, 226, 180};
         case 0x3B:
-            return sf::Color(160, 214, 228, 255);
+            return {160, 214, 228};
         case 0x3C:
-            return sf::Color(160, 162, 160, 255);
+            return {160, 162, 160};
         default:
-            return sf::Color(0, 0, 0, 255);
+            return {0, 0, 0};
     }
 }
@@ -1,3 +1,16 @@
+#pragma once
+
+#include <vector>
+#include "SaveState.h"
+#include "Profiler.h"
+
+class Mapper;
+
+enum PPURenderer {
+    DotRenderer, // Renders the background one pixel at a time
+    ScanlineRenderer // Renders the background a tile at a time. Output is the same as DotRenderer's
+};
+
 enum PPUReg {
     PPUCTRL, PPUMASK, PPUSTATUS, OAMADDR, Latch1, Latch2, PPUSCROLL, PPUADDR, PPUDATA
 };
@@ -16,6 +29,12 @@ struct NameTable {
     }
 };
 
+struct Colour {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+};
+
 struct Palette {
     unsigned char Colours[3];
 };
@@ -26,16 +45,14 @@ public:
         palette.Colours[0] = 0;
         palette.Colours[1] = 0;
         palette.Colours[2] = 0;
-        bitmapLo = 0;
-        bitmapHi = 0;
+        bitmap = 0;
         XPos = 0;
         YPos = 0;
     }
 
     Palette palette;
-    bool padding; // This is required to be here or the bitmapLo variable becomes corrupted - need to look at this in case we are writing out of the array's bounds somewhere
-    unsigned char bitmapLo;
-    unsigned char bitmapHi;
+    bool padding; // This is required to be here or the bitmap variable becomes corrupted - need to look at this in case we are writing out of the array's bounds somewhere
+    unsigned short bitmap; // Decoded bitmap for this scanline, 2 bits per pixel with the next pixel in the top 2 bits
     unsigned char XPos;
     unsigned char YPos;
 };
@@ -44,14 +61,14 @@ class PPU {
 
 public:
 
-    sf::Image *displayImage;
-    sf::Texture *displayTexture;
-    sf::Uint8 *pixels;
+    unsigned char *pixels; // RGBA output of the last call to draw(), 256x240
     unsigned char registers[8];
     bool NMIFired;
     bool CHRRAM;
-    int nameTableMirrorMode;
+    Mapper *mapper; // The cartridge's mapper, clocked once per rendered scanline
     unsigned char OAMAddress;
+    PPURenderer renderer;
+    Profiler *profiler; // Counts dots and times rendering when NESTALGIA_PROFILER is defined
 
     PPU();
 
@@ -59,15 +76,35 @@ public:
 
     void execute(int PPUClock);
 
-    void draw(sf::RenderWindow &window);
+    void catchUp(unsigned long long CPUCycle); // Run the PPU up to the given CPU cycle
+
+    int cyclesUntilVBlank(); // The number of CPU cycles to run before the PPU will have started VBLANK (PPU must be caught up)
+
+    int cyclesUntilScanlineClock(int scanlines); // CPU cycles until the mapper has been clocked this many more times
+
+    void setMirroring(int mirroring); // Takes a NameTableMirroring
+
+    void setCHRBanks(const int *banks); // Offsets into CHR memory of the 8 1KiB banks the pattern tables are made of
+
+    void draw();
+
+    const unsigned char *getNESPixels();
+
+    unsigned long long getFrameNumber(); // Goes up by one each time the PPU finishes drawing a frame
+
+    int getDotsPerFrame(); // PPU clocks from the start of one frame to the start of the next
+
+    unsigned long long getFrameHash(); // Changes when the output of draw() would change
 
     void writeRegister(unsigned short registerId, unsigned char value);
 
     unsigned char readRegister(unsigned short location);
 
-    void writeCROM(unsigned short location, unsigned char value);
+    void loadCHR(const unsigned char *CHRROM, int size); // Use the cartridge's CHR-ROM, or CHR-RAM if CHRROM is nullptr
 
-    unsigned char readCROM(unsigned short location);
+    void saveState(StateWriter &state); // Write the PPU's memory and registers and where it is in the frame (not the picture)
+
+    void loadState(StateReader &state);
 
     void writeOAM(unsigned short location, unsigned char value);
 
@@ -75,7 +112,7 @@ public:
 
 private:
     SpriteUnit *spriteUnits[8];
-    int PPUClocks;
+    unsigned long long lastSyncCycle; // The CPU cycle the PPU was last caught up to
     int tileCounter;
     int currentCycle;
     int currentTile;
@@ -95,8 +132,13 @@ private:
     unsigned char bitmapLo;
     unsigned char bitmapHi;
     Palette currentPalette;
-    unsigned char cROM[0x80000]; // 512KiB max - PPU has its own memory for CHR data, this will be copied over from the MemoryManager's cartridge upon ROM load
+    const unsigned char *CHRMemory; // CHR data the pattern tables are read from - the cartridge's CHR-ROM, or CHRRAMData
+    std::vector<unsigned char> CHRRAMData; // 8KiB of CHR-RAM, for cartridges that don't have CHR-ROM
+    std::vector<unsigned short> tileRows; // CHRMemory decoded into 2 bits per pixel, first pixel in the top bits. Every 16 bytes of CHR data is a tile with 8 rows.
+    std::vector<unsigned short> tileRowsFlipped; // The same with the pixels in reverse order, for horizontally flipped sprites
+    unsigned short currentTileRow; // Decoded bitmap of the background tile being drawn by the scanline renderer
     int frame = 0;
+    unsigned long long frameNumber;
     int OldAttribute;
     unsigned char tempOAM[0x20]; // Temporary OAM, holds the data for the sprites on the currently-rendering scanline. Should be filled by a sprite evaluation function executed during the previous scanline.
     int spritesOnThisScanline;
@@ -104,14 +146,22 @@ private:
     bool spriteExists[8];
     bool SpriteZeroOnThisScanline;
     unsigned char OAM[256];
-    NameTable Nametables[4]; // PPU has 4 nametables. (Extra one here for data padding - might need to look at later: Sprites get corrupted when writing to nametable 3 otherwise)
+    NameTable Nametables[4]; // Nametable memory. The PPU has 2 nametables built in, the other 2 are only used by carts with four screen mirroring
+    unsigned char *nameTableMap[4]; // Memory behind each of the nametables at $2000, $2400, $2800 and $2C00
+    int nameTableMirrorMode;
+    int CHRBanks[8];
+    static const int dotsPerFrame = 261 * 341; // PPU clocks per frame, as execute() counts them
     bool pad;
     unsigned char PaletteMemory[0x20]; // Memory for storing colour palette information
     unsigned char *NESPixels;
+    unsigned int RGBAPalette[8 * 64]; // Every NES colour as RGBA bytes, once for each setting of the emphasis bits in PPUMASK
+    unsigned short bitplaneSpread[256]; // Each byte with its bits moved to the even bits of a short
     void RenderNametable(int Nametable, int OffsetX, int OffsetY);
-    sf::Sprite *displaySprite;
+    Colour getColour(unsigned char NESColour);
+
+    void renderDots(int firstCycle, int endCycle);
 
-    sf::Color getColour(unsigned char NESColour);
+    void renderScanline(int firstCycle, int endCycle);
 
     void drawPixel(unsigned char value, int scanLine, int pixel);
 
@@ -145,14 +195,24 @@ private:
      */
     void getBitmapDataFromNameTable(unsigned short databus);
 
+    unsigned short getBackgroundPatternAddress(unsigned short databus);
+
+    unsigned int getCHRAddress(unsigned short location);
+
+    int getTileRow(unsigned int location);
+
+    int getFramePosition();
+
+    bool isRendering();
+
+    void decodeTileRow(unsigned int location);
+
     unsigned char readAttribute(int pixel, int scanline, int nameTable);
 
     void readColour(int attribute);
 
     void readColour(int attribute, int spriteId);
 
-    unsigned char readPatternTable(unsigned short Location, int PatternType);
-
     void drawBitmapPixel(bool lo, bool hi, int pixel, int scanLine);
 
     void drawBitmapPixel(bool lo, bool hi, int pixel, int scanLine, int spriteId);
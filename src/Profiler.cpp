@@ -0,0 +1,169 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include "CPUInstructions.h"
+#include "Profiler.h"
+
+Profiler::Profiler() {
+#ifdef NESTALGIA_PROFILER
+    addressCount.resize(0x10000);
+    addressCycles.resize(0x10000);
+    addressOpcode.resize(0x10000);
+#endif
+    reset();
+}
+
+void Profiler::reset() {
+    std::memset(opcodeCount, 0, sizeof(opcodeCount));
+    std::memset(opcodeCycles, 0, sizeof(opcodeCycles));
+    std::fill(addressCount.begin(), addressCount.end(), 0);
+    std::fill(addressCycles.begin(), addressCycles.end(), 0);
+    std::memset(PPUDots, 0, sizeof(PPUDots));
+    std::memset(sectionTime, 0, sizeof(sectionTime));
+    DMACycles = 0;
+    frames = 0;
+    sectionStack[0] = ProfileFrontend;
+    sectionDepth = 0;
+    sectionStart = startTime = Clock::now();
+}
+
+void Profiler::switchSection() {
+    Clock::time_point now = Clock::now();
+    int depth = sectionDepth < ProfileStackDepth ? sectionDepth : ProfileStackDepth - 1;
+    sectionTime[sectionStack[depth]] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - sectionStart).count();
+    sectionStart = now;
+}
+
+void Profiler::enter(ProfileSection section) {
+    switchSection();
+
+    // Sections only nest a few deep - if they ever go deeper, the extra time is charged to the innermost one kept
+    if (sectionDepth + 1 < ProfileStackDepth) {
+        sectionStack[sectionDepth + 1] = section;
+    } else {
+        sectionStack[ProfileStackDepth - 1] = section;
+    }
+
+    sectionDepth++;
+}
+
+void Profiler::leave() {
+    switchSection();
+
+    if (sectionDepth > 0)
+        sectionDepth--;
+}
+
+void Profiler::countPPUDots(int scanline, int firstDot, int endDot) {
+    if (scanline < 0) {
+        PPUDots[PhasePreRender] += endDot - firstDot;
+    } else if (scanline >= 240) {
+        PPUDots[PhaseVBlank] += endDot - firstDot;
+    } else {
+        int visible = std::max(0, std::min(endDot, 257) - std::max(firstDot, 1));
+        PPUDots[PhaseVisible] += visible;
+        PPUDots[PhaseHBlank] += endDot - firstDot - visible;
+    }
+}
+
+#ifdef NESTALGIA_PROFILER
+static double percent(double part, double whole) {
+    return whole > 0 ? part * 100 / whole : 0;
+}
+#endif
+
+void Profiler::report(std::ostream &output) {
+#ifndef NESTALGIA_PROFILER
+    output << "Profiler: not compiled in - build with NESTALGIA_PROFILER defined to use it" << std::endl;
+#else
+    switchSection();
+
+    const int TopCount = 20;
+    std::ios::fmtflags flags = output.flags();
+    char fill = output.fill();
+    output << std::fixed << std::setprecision(1) << std::setfill(' ');
+
+    // Host time
+    static const char *sectionNames[ProfileSectionCount] = {"Frontend", "CPU", "PPU", "PPU rendering", "APU", "Savestates"};
+    double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    long long totalTime = 0;
+
+    for (int i = 0; i < ProfileSectionCount; i++) {
+        totalTime += sectionTime[i];
+    }
+
+    output << "Profile of " << frames << " frames over " << seconds << "s" << std::endl;
+    output << std::endl << "Host time          ms      %   us/frame" << std::endl;
+
+    for (int i = 0; i < ProfileSectionCount; i++) {
+        output << "  " << std::left << std::setw(14) << sectionNames[i] << std::right << std::setw(8)
+               << sectionTime[i] / 1e6 << std::setw(7) << percent(sectionTime[i], totalTime) << std::setw(11)
+               << (frames ? sectionTime[i] / 1e3 / frames : 0) << std::endl;
+    }
+
+    // PPU dots
+    static const char *phaseNames[PPUPhaseCount] = {"Visible", "HBlank", "VBlank", "Pre-render"};
+    unsigned long long totalDots = 0;
+
+    for (int i = 0; i < PPUPhaseCount; i++) {
+        totalDots += PPUDots[i];
+    }
+
+    output << std::endl << "PPU dots               count      %" << std::endl;
+
+    for (int i = 0; i < PPUPhaseCount; i++) {
+        output << "  " << std::left << std::setw(14) << phaseNames[i] << std::right << std::setw(14) << PPUDots[i]
+               << std::setw(7) << percent(PPUDots[i], totalDots) << std::endl;
+    }
+
+    // Opcodes, busiest first
+    unsigned long long totalCycles = DMACycles;
+    std::vector<int> opcodes;
+
+    for (int i = 0; i < 256; i++) {
+        totalCycles += opcodeCycles[i];
+
+        if (opcodeCount[i])
+            opcodes.push_back(i);
+    }
+
+    std::sort(opcodes.begin(), opcodes.end(), [this](int a, int b) { return opcodeCycles[a] > opcodeCycles[b]; });
+
+    output << std::endl << "CPU cycles: " << totalCycles << " (" << DMACycles << " stalled for OAM DMA)" << std::endl;
+    output << std::endl << "Opcode                  count        cycles      %" << std::endl;
+
+    for (int i = 0; i < (int) opcodes.size() && i < TopCount; i++) {
+        int opcode = opcodes[i];
+        output << "  $" << std::hex << std::uppercase << std::setfill('0') << std::setw(2) << opcode << std::dec
+               << std::setfill(' ') << " " << std::left << std::setw(12) << M6502::instructionTable[opcode].name
+               << std::right << std::setw(10) << opcodeCount[opcode] << std::setw(14) << opcodeCycles[opcode]
+               << std::setw(7) << percent(opcodeCycles[opcode], totalCycles) << std::endl;
+    }
+
+    // Program counter hot spots
+    std::vector<int> addresses;
+
+    for (int i = 0; i < 0x10000; i++) {
+        if (addressCount[i])
+            addresses.push_back(i);
+    }
+
+    int hotSpots = std::min(TopCount, (int) addresses.size());
+    std::partial_sort(addresses.begin(), addresses.begin() + hotSpots, addresses.end(),
+                      [this](int a, int b) { return addressCycles[a] > addressCycles[b]; });
+
+    output << std::endl << "Address                 count        cycles      %" << std::endl;
+
+    for (int i = 0; i < hotSpots; i++) {
+        int address = addresses[i];
+        output << "  $" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << address << std::dec
+               << std::setfill(' ') << " " << std::left << std::setw(10) << M6502::instructionTable[addressOpcode[address]].name
+               << std::right << std::setw(10) << addressCount[address] << std::setw(14) << addressCycles[address]
+               << std::setw(7) << percent(addressCycles[address], totalCycles) << std::endl;
+    }
+
+    output.flags(flags);
+    output.fill(fill);
+#endif
+}
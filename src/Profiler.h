@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <iosfwd>
+
+// Where the host's time goes. Each section's time excludes the sections started inside it, so the PPU catching up in
+// the middle of a CPU instruction counts as PPU time, not CPU time.
+enum ProfileSection {
+    ProfileFrontend, // Everything outside MainSystem::execute() - drawing, input, frame limiting
+    ProfileCPU,
+    ProfilePPU,
+    ProfilePPURender, // Drawing the visible pixels, part of the PPU's time
+    ProfileAPU,
+    ProfileSaveState, // Saving and loading states for rewind and run-ahead
+    ProfileSectionCount
+};
+
+// The parts of a scanline, for counting how many PPU dots are spent in each
+enum PPUPhase {
+    PhaseVisible, // Dots 1-256 of scanlines 0-239
+    PhaseHBlank, // Dots 0 and 257-340 of scanlines 0-239, where sprites for the next line are fetched
+    PhaseVBlank, // Scanlines 240-260
+    PhasePreRender, // Scanline -1
+    PPUPhaseCount
+};
+
+/*
+ * Counts where emulated and host time goes: executions and cycles of each opcode and program counter, PPU dots in each
+ * part of the scanline, and host time in each part of the emulator.
+ *
+ * Counting costs time of its own, so the hooks that feed the profiler are only compiled in when NESTALGIA_PROFILER is
+ * defined (the NESTALGIA_PROFILER CMake option). Without it the profiler stays empty and report() says so.
+ */
+class Profiler {
+public:
+    Profiler();
+
+    void reset();
+
+    void enter(ProfileSection section); // Start timing a section, until the matching leave()
+
+    void leave();
+
+    void countInstruction(unsigned short address, unsigned char opcode, int cycles) {
+        opcodeCount[opcode]++;
+        opcodeCycles[opcode] += cycles;
+        addressCount[address]++;
+        addressCycles[address] += cycles;
+        addressOpcode[address] = opcode;
+    }
+
+    void countDMA(int cycles) {
+        DMACycles += cycles;
+    }
+
+    void countPPUDots(int scanline, int firstDot, int endDot); // Dots firstDot up to (but not including) endDot
+
+    void countFrame() {
+        frames++;
+    }
+
+    void report(std::ostream &output); // Print everything counted since the last reset()
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    unsigned long long opcodeCount[256];
+    unsigned long long opcodeCycles[256];
+    std::vector<unsigned long long> addressCount; // Indexed by the CPU address of the opcode
+    std::vector<unsigned long long> addressCycles;
+    std::vector<unsigned char> addressOpcode; // The last opcode run from each address, banks can change what's there
+    unsigned long long DMACycles;
+    unsigned long long PPUDots[PPUPhaseCount];
+    unsigned long long frames;
+
+    long long sectionTime[ProfileSectionCount]; // Host nanoseconds
+    static const int ProfileStackDepth = 16;
+    ProfileSection sectionStack[ProfileStackDepth];
+    int sectionDepth;
+    Clock::time_point sectionStart; // When the section on top of the stack was last entered or returned to
+    Clock::time_point startTime;
+
+    void switchSection(); // Charge the time since sectionStart to the current section
+};
+
+// Times the rest of the scope as the given section
+class ProfileScope {
+public:
+    ProfileScope(Profiler *mProfiler, ProfileSection section) {
+        profiler = mProfiler;
+        profiler->enter(section);
+    }
+
+    ~ProfileScope() {
+        profiler->leave();
+    }
+
+private:
+    Profiler *profiler;
+};
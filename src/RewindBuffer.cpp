@@ -0,0 +1,182 @@
+#include <cstring>
+#include "RewindBuffer.h"
+
+// Each delta is a series of (unchanged byte count, changed byte count, changed bytes XOR'd) records, with the counts
+// as variable-length integers of 7 bits per byte.
+static void writeCount(std::vector<unsigned char> &output, size_t count) {
+    while (count >= 0x80) {
+        output.push_back((unsigned char) (count | 0x80));
+        count >>= 7;
+    }
+
+    output.push_back((unsigned char) count);
+}
+
+static bool readCount(const unsigned char *&input, const unsigned char *end, size_t &count) {
+    count = 0;
+
+    for (int shift = 0; input < end && shift < 64; shift += 7) {
+        unsigned char byte = *input++;
+        count |= (size_t) (byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+RewindBuffer::RewindBuffer(size_t mCapacity, size_t mMaxFrames) {
+    ring.resize(mCapacity);
+    maxFrames = mMaxFrames;
+    head = 0;
+}
+
+void RewindBuffer::push(const std::vector<unsigned char> &state) {
+    if (state.size() != newest.size()) {
+        // The first state, or a state of a different ROM - there's nothing to make a delta against
+        clear();
+        newest = state;
+        return;
+    }
+
+    encodeDelta(newest.data(), state.data(), state.size());
+    newest = state;
+
+    if (encoded.size() > ring.size()) {
+        // Too big to ever fit, so the history can't go back past this state
+        deltas.clear();
+        head = 0;
+        return;
+    }
+
+    // Deltas are never split across the end of the ring. Anything still in the unused space at the end is older than
+    // everything at the start, so it goes too.
+    if (head + encoded.size() > ring.size()) {
+        while (!deltas.empty() && deltas.front().offset >= head) {
+            deltas.pop_front();
+        }
+
+        head = 0;
+    }
+
+    // Drop the oldest deltas until there is room
+    while (!deltas.empty() && deltas.front().offset < head + encoded.size() && deltas.front().offset >= head) {
+        deltas.pop_front();
+    }
+
+    while (!deltas.empty() && deltas.size() >= maxFrames) {
+        deltas.pop_front();
+    }
+
+    std::memcpy(&ring[head], encoded.data(), encoded.size());
+    deltas.push_back({head, encoded.size()});
+    head += encoded.size();
+}
+
+bool RewindBuffer::pop(std::vector<unsigned char> &state) {
+    if (deltas.empty())
+        return false;
+
+    Delta delta = deltas.back();
+    deltas.pop_back();
+    head = delta.offset;
+
+    if (!applyDelta(&ring[delta.offset], delta.length, newest.data(), newest.size())) {
+        clear();
+        return false;
+    }
+
+    state = newest;
+    return true;
+}
+
+void RewindBuffer::clear() {
+    deltas.clear();
+    newest.clear();
+    head = 0;
+}
+
+size_t RewindBuffer::frames() {
+    return deltas.size();
+}
+
+size_t RewindBuffer::bytesUsed() {
+    size_t used = 0;
+
+    for (const Delta &delta : deltas) {
+        used += delta.length;
+    }
+
+    return used;
+}
+
+void RewindBuffer::encodeDelta(const unsigned char *older, const unsigned char *newer, size_t size) {
+    encoded.clear();
+    size_t position = 0;
+
+    while (position < size) {
+        // Skip over the bytes that haven't changed, 8 at a time where possible
+        size_t unchangedStart = position;
+
+        while (position + 8 <= size && std::memcmp(older + position, newer + position, 8) == 0) {
+            position += 8;
+        }
+
+        while (position < size && older[position] == newer[position]) {
+            position++;
+        }
+
+        if (position == size)
+            break; // Nothing changed after the last record
+
+        // Then take the changed bytes, up to the next run of unchanged ones long enough to be worth a new record
+        size_t changedStart = position;
+
+        while (position < size) {
+            size_t unchanged = 0;
+
+            while (unchanged < 4 && position + unchanged < size && older[position + unchanged] == newer[position + unchanged]) {
+                unchanged++;
+            }
+
+            if (unchanged == 4 || position + unchanged == size) {
+                break;
+            }
+
+            position += unchanged + 1;
+        }
+
+        writeCount(encoded, changedStart - unchangedStart);
+        writeCount(encoded, position - changedStart);
+
+        for (size_t i = changedStart; i < position; i++) {
+            encoded.push_back(older[i] ^ newer[i]);
+        }
+    }
+}
+
+bool RewindBuffer::applyDelta(const unsigned char *delta, size_t length, unsigned char *state, size_t size) {
+    // XOR the changes back into the state. XOR is its own inverse, so this turns the newer state back into the older.
+    const unsigned char *end = delta + length;
+    size_t position = 0;
+
+    while (delta < end) {
+        size_t unchanged;
+        size_t changed;
+
+        if (!readCount(delta, end, unchanged) || !readCount(delta, end, changed))
+            return false;
+
+        if (unchanged > size - position || changed > size - position - unchanged || changed > (size_t) (end - delta))
+            return false;
+
+        position += unchanged;
+
+        for (size_t i = 0; i < changed; i++) {
+            state[position++] ^= *delta++;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+
+/*
+ * History of savestates for stepping the emulator backwards, one frame at a time.
+ *
+ * Only the newest state is kept whole. Every state before it is stored as the XOR of it and the state after it, with
+ * the runs of zeros (bytes that didn't change) run-length encoded - most frames only touch a few hundred bytes. The
+ * deltas are kept in a fixed-size ring, and the oldest are dropped to make room for new ones.
+ */
+class RewindBuffer {
+public:
+    RewindBuffer(size_t mCapacity, size_t mMaxFrames); // Keep at most mCapacity bytes of deltas, for mMaxFrames frames
+
+    void push(const std::vector<unsigned char> &state); // Record the newest state
+
+    bool pop(std::vector<unsigned char> &state); // Drop the newest state and return the one before it, false if there isn't one
+
+    void clear();
+
+    size_t frames(); // The number of times pop() can be called
+
+    size_t bytesUsed(); // Bytes of the ring holding deltas
+
+private:
+    struct Delta {
+        size_t offset; // Position in ring
+        size_t length;
+    };
+
+    std::vector<unsigned char> ring;
+    std::deque<Delta> deltas; // Oldest first, laid out in the ring in the same order
+    size_t head; // Where the next delta will be written
+    size_t maxFrames;
+    std::vector<unsigned char> newest; // The last state pushed, in full
+    std::vector<unsigned char> encoded; // Scratch space for the delta being pushed
+
+    void encodeDelta(const unsigned char *older, const unsigned char *newer, size_t size);
+
+    bool applyDelta(const unsigned char *delta, size_t length, unsigned char *state, size_t size);
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+
+// A savestate is the state of each part of the system written one after the other as raw bytes, in the order
+// MainSystem::saveState() visits them. There are no field names or tags - the version number in the header changes
+// whenever the layout does, and states from other versions are rejected.
+static const unsigned int SaveStateMagic = 0x5453454E; // "NEST"
+static const unsigned int SaveStateVersion = 3;
+
+// Appends values to a savestate buffer
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<unsigned char> &mBuffer) {
+        buffer = &mBuffer;
+    }
+
+    void write(const void *data, size_t size) {
+        size_t position = buffer->size();
+        buffer->resize(position + size);
+        std::memcpy(buffer->data() + position, data, size);
+    }
+
+    template<class T>
+    void write(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written to a savestate");
+        write(&value, sizeof(T));
+    }
+
+private:
+    std::vector<unsigned char> *buffer;
+};
+
+// Reads values back out of a savestate in the order they were written. Reading past the end of the state sets failed
+// and leaves the destination untouched.
+class StateReader {
+public:
+    bool failed;
+
+    StateReader(const unsigned char *mData, size_t mSize) {
+        data = mData;
+        size = mSize;
+        position = 0;
+        failed = false;
+    }
+
+    const unsigned char *readBytes(size_t length) {
+        // Returns a pointer to the next length bytes of the state, or nullptr if there aren't that many left
+        if (failed || length > size - position) {
+            failed = true;
+            return nullptr;
+        }
+
+        const unsigned char *bytes = data + position;
+        position += length;
+        return bytes;
+    }
+
+    void read(void *destination, size_t length) {
+        const unsigned char *bytes = readBytes(length);
+
+        if (bytes)
+            std::memcpy(destination, bytes, length);
+    }
+
+    template<class T>
+    void read(T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read from a savestate");
+        read(&value, sizeof(T));
+    }
+
+    bool atEnd() {
+        return position == size;
+    }
+
+private:
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+};
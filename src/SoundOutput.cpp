@@ -0,0 +1,20 @@
+#include "APU.h"
+#include "SoundOutput.h"
+
+SoundOutput::SoundOutput(AudioRingBuffer &mRing) {
+    ring = &mRing;
+    chunk.resize(ChunkSize);
+    initialize(1, APU::SampleRate);
+}
+
+bool SoundOutput::onGetData(Chunk &data) {
+    // Always hand back a full chunk and carry on - returning false would stop the stream
+    ring->read(chunk.data(), chunk.size());
+    data.samples = chunk.data();
+    data.sampleCount = chunk.size();
+    return true;
+}
+
+void SoundOutput::onSeek(sf::Time /*timeOffset*/) {
+    // The sound is live, there's nowhere to seek to
+}
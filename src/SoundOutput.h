@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Audio.hpp>
+#include "AudioRingBuffer.h"
+
+/*
+ * Plays the emulator's sound. SFML asks for each chunk from its own audio thread, and the chunk is taken from the ring
+ * the emulation thread writes into, so the two never wait on each other. If the emulator falls behind, the gap is
+ * filled with silence rather than holding up playback.
+ */
+class SoundOutput : public sf::SoundStream {
+public:
+  static const size_t ChunkSize = 1024; // Samples handed to SFML at a time, about 21ms at 48kHz
+
+  explicit SoundOutput(AudioRingBuffer &mRing);
+
+protected:
+  bool onGetData(Chunk &data) override;
+
+  void onSeek(sf::Time timeOffset) override;
+
+private:
+  AudioRingBuffer *ring;
+  std::vector<sf::Int16> chunk; // SFML keeps using the samples until it asks for the next chunk
+};
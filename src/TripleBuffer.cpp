@@ -0,0 +1,35 @@
+#include "TripleBuffer.h"
+
+TripleBuffer::TripleBuffer(size_t mSize) {
+    for (int i = 0; i < 3; i++) {
+        buffers[i].resize(mSize);
+    }
+
+    back = 0;
+    middle = 1;
+    front = 2;
+}
+
+unsigned char *TripleBuffer::getWriteBuffer() {
+    return buffers[back].data();
+}
+
+void TripleBuffer::publish() {
+    // Release so that the reader sees the whole frame once it sees the swap, acquire to get the buffer back safely
+    int previous = middle.exchange(back | NewFrame, std::memory_order_acq_rel);
+    back = previous & IndexMask;
+}
+
+bool TripleBuffer::update() {
+    if (!(middle.load(std::memory_order_relaxed) & NewFrame))
+        return false;
+
+    // Only the reader clears NewFrame, so it is still set - even if the writer has published again since
+    int previous = middle.exchange(front, std::memory_order_acq_rel);
+    front = previous & IndexMask;
+    return true;
+}
+
+const unsigned char *TripleBuffer::getReadBuffer() {
+    return buffers[front].data();
+}
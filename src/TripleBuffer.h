@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/*
+ * Hands finished frames from the emulation thread to the thread that shows them, without either ever waiting.
+ *
+ * There are three buffers: one the writer is filling, one the reader is showing, and one in the middle holding the
+ * newest finished frame. Publishing swaps the writer's buffer with the middle one, and taking a frame swaps the reader's
+ * buffer with it, so each side always has a buffer of its own. If the writer publishes twice before the reader looks,
+ * the older frame is simply dropped.
+ */
+class TripleBuffer {
+public:
+    explicit TripleBuffer(size_t mSize); // Bytes in each buffer
+
+    // Writer side
+    unsigned char *getWriteBuffer(); // The buffer to fill with the next frame
+
+    void publish(); // Make the write buffer the newest frame, and get another to write into
+
+    // Reader side
+    bool update(); // Take the newest frame if one has been published since the last update(), false if there isn't one
+
+    const unsigned char *getReadBuffer(); // The frame taken by the last update()
+
+private:
+    static const int IndexMask = 3;
+    static const int NewFrame = 4; // Set in middle when the writer has published a frame the reader hasn't taken
+
+    std::vector<unsigned char> buffers[3];
+    std::atomic<int> middle; // The index of the buffer between the two sides, plus NewFrame
+    int back; // Only used by the writer
+    int front; // Only used by the reader
+};